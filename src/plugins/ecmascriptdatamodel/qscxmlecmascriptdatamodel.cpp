@@ -46,6 +46,8 @@
 
 #include <qjsengine.h>
 #include <qjsondocument.h>
+#include <qjsvalueiterator.h>
+#include <qset.h>
 #include <QtQml/private/qjsvalue_p.h>
 #include <QtQml/private/qv4scopedvalue_p.h>
 
@@ -64,9 +66,29 @@ typedef std::function<QVariant (bool *)> ToVariantEvaluator;
 typedef std::function<void (bool *)> ToVoidEvaluator;
 typedef std::function<bool (bool *, std::function<bool ()>)> ForeachEvaluator;
 
+namespace {
+struct JsonLiteral
+{
+    QString expr;
+    bool isLiteral;
+};
+
+typedef std::pair<const void *, EvaluatorId> JsonLiteralKey; // document tables, initializer
+enum { MaxJsonLiterals = 1 << 12 };
+thread_local QHash<JsonLiteralKey, JsonLiteral> jsonLiterals;
+} // namespace
+
 class QScxmlEcmaScriptDataModelPrivate : public QScxmlDataModelPrivate
 {
     Q_DECLARE_PUBLIC(QScxmlEcmaScriptDataModel)
+
+    enum SetPropertyResult {
+        SetPropertySucceeded,
+        SetReadOnlyPropertyFailed,
+        SetUnknownPropertyFailed,
+        SetPropertyFailedForAnotherReason,
+    };
+
 public:
     QScxmlEcmaScriptDataModelPrivate()
         : jsEngine(nullptr)
@@ -121,6 +143,21 @@ public:
 
     void setupDataModel()
     {
+        // Setting up a data model again, as happens when a recycled child state machine is
+        // invoked anew, keeps the engine and only removes what the previous run stored in the
+        // global object. Variables declared by scripts cannot be removed, so if there are any,
+        // the engine is replaced by a clean one.
+        if (!dataModel.isUndefined()) {
+            dataModel = QJSValue();
+            if (!clearGlobals()) {
+                jsonParse = QJSValue();
+                validForeachItems.clear();
+                delete jsEngine; // owns the platform properties
+                jsEngine = nullptr;
+                platformProperties = nullptr;
+            }
+        }
+
         QJSEngine *engine = assertEngine();
         dataModel = engine->globalObject();
 
@@ -130,10 +167,9 @@ public:
 
     void setupSystemVariables()
     {
-        setReadonlyProperty(&dataModel, QStringLiteral("_sessionid"),
-                            m_stateMachine->sessionId());
+        setSystemVariable(QStringLiteral("_sessionid"), m_stateMachine->sessionId());
 
-        setReadonlyProperty(&dataModel, QStringLiteral("_name"), m_stateMachine->name());
+        setSystemVariable(QStringLiteral("_name"), m_stateMachine->name());
 
         QJSEngine *engine = assertEngine();
         auto scxml = engine->newObject();
@@ -141,15 +177,66 @@ public:
                           .arg(m_stateMachine->sessionId()));
         auto ioProcs = engine->newObject();
         setReadonlyProperty(&ioProcs, QStringLiteral("scxml"), scxml);
-        setReadonlyProperty(&dataModel, QStringLiteral("_ioprocessors"), ioProcs);
+        setSystemVariable(QStringLiteral("_ioprocessors"), ioProcs);
 
-        auto platformVars = QScxmlPlatformProperties::create(engine, m_stateMachine);
-        dataModel.setProperty(QStringLiteral("_x"), platformVars->jsValue());
+        // Platform properties are owned by the engine, which is kept when the data model is set
+        // up again.
+        delete platformProperties;
+        platformProperties = QScxmlPlatformProperties::create(engine, m_stateMachine);
+        dataModel.setProperty(QStringLiteral("_x"), platformProperties->jsValue());
 
         dataModel.setProperty(QStringLiteral("In"), engine->evaluate(
                                   QStringLiteral("(function(id){return _x.inState(id);})")));
     }
 
+    // Creates the value of a <data> initializer with JSON.parse, which is a lot cheaper than
+    // compiling and running it as a script. Returns an undefined value if expr is no JSON text.
+    // Whether it is one is the same for all sessions of a document, so the answer is kept per
+    // thread for the document's tables. The expression is kept too, as the tables of a document
+    // loaded at runtime may be deleted and their address reused.
+    QJSValue parseJsonLiteral(EvaluatorId id, const QString &expr)
+    {
+        const JsonLiteralKey key(documentTables(), id);
+        const auto it = jsonLiterals.constFind(key);
+        const bool known = it != jsonLiterals.constEnd() && it->expr == expr;
+        if (known && !it->isLiteral)
+            return QJSValue();
+
+        QJSValue value;
+        // JSON.parse turns a "__proto__" key into an own property, an object literal doesn't.
+        if (known || !expr.contains(QLatin1String("__proto__"))) {
+            value = parseJson(expr);
+            if (value.isError())
+                value = QJSValue();
+        }
+        if (!known) {
+            if (jsonLiterals.size() >= MaxJsonLiterals)
+                jsonLiterals.clear();
+            jsonLiterals.insert(key, { expr, !value.isUndefined() });
+        }
+        return value;
+    }
+
+    // The tables of a compiled state machine are shared by all its instances.
+    const void *documentTables() const
+    {
+        const QScxmlStateMachinePrivate *machine
+                = QScxmlStateMachinePrivate::get(m_stateMachine.value());
+        if (const QScxmlTableData::StaticTables *tables = machine->staticTables())
+            return tables;
+        return machine->m_tableData.value();
+    }
+
+    QJSValue parseJson(const QString &json)
+    {
+        QJSEngine *engine = assertEngine();
+        if (jsonParse.isUndefined()) {
+            jsonParse = engine->globalObject().property(QStringLiteral("JSON"))
+                    .property(QStringLiteral("parse"));
+        }
+        return jsonParse.call({ QJSValue(json) });
+    }
+
     void assignEvent(const QScxmlEvent &event)
     {
         if (event.name().isEmpty())
@@ -174,7 +261,7 @@ public:
         if (event.isErrorEvent())
             _event.setProperty(QStringLiteral("errorMessage"), event.errorMessage());
 
-        setReadonlyProperty(&dataModel, QStringLiteral("_event"), _event);
+        setSystemVariable(QStringLiteral("_event"), _event);
     }
 
     QJSValue eventDataAsJSValue(const QVariant &eventData)
@@ -213,11 +300,74 @@ public:
         if (!jsEngine) {
             Q_Q(QScxmlEcmaScriptDataModel);
             setEngine(new QJSEngine(q->stateMachine()));
+            builtins = globalNames();
         }
 
         return jsEngine;
     }
 
+    // Removes this data model's variables from the global object. Variables declared by scripts
+    // cannot be deleted. They are set to undefined, and false is returned.
+    bool clearGlobals()
+    {
+        bool cleared = true;
+        forEachGlobal([&cleared](QJSValue *global, const QString &name) {
+            if (!global->deleteProperty(name)) {
+                global->setProperty(name, QJSValue(QJSValue::UndefinedValue));
+                cleared = false;
+            }
+        });
+        return cleared;
+    }
+
+    QSet<QString> globalNames() const
+    {
+        QSet<QString> names;
+        for (QJSValueIterator it(jsEngine->globalObject()); it.hasNext();) {
+            it.next();
+            names.insert(it.name());
+        }
+        return names;
+    }
+
+    template<typename Function>
+    void forEachGlobal(Function function)
+    {
+        QJSValue global = jsEngine->globalObject();
+        QStringList names;
+        for (QJSValueIterator it(global); it.hasNext();) {
+            it.next();
+            if (!builtins.contains(it.name()) && !isSystemVariable(it.name()))
+                names.append(it.name());
+        }
+        for (const QString &name : systemVariables()) {
+            if (global.hasOwnProperty(name))
+                names.append(name);
+        }
+        for (const QString &name : std::as_const(names))
+            function(&global, name);
+    }
+
+    static const QStringList &systemVariables()
+    {
+        static const QStringList names = {
+            QStringLiteral("_sessionid"), QStringLiteral("_name"),
+            QStringLiteral("_ioprocessors"), QStringLiteral("_event")
+        };
+        return names;
+    }
+
+    static bool isSystemVariable(const QString &name)
+    { return systemVariables().contains(name); }
+
+    // System variables are read-only. They have to be configurable, so that they can be defined
+    // again when the data model is set up anew.
+    void setSystemVariable(const QString &name, const QJSValue &value)
+    {
+        QJSValue global = jsEngine->globalObject();
+        setReadonlyProperty(&global, name, value, true);
+    }
+
     QJSEngine *engine() const
     {
         return jsEngine;
@@ -228,7 +378,7 @@ public:
 
     QString string(StringId id) const
     {
-        return m_stateMachine->tableData()->string(id);
+        return QScxmlStateMachinePrivate::get(m_stateMachine.value())->string(id);
     }
 
     bool hasProperty(const QString &name) const
@@ -238,9 +388,65 @@ public:
     { return dataModel.property(name); }
 
     bool setProperty(const QString &name, const QJSValue &value, const QString &context)
+    {
+        return checkSetProperty(setProperty(&dataModel, name, value), name, context);
+    }
+
+    // The item is checked once per <foreach> element. It can't change, but evaluating the check
+    // every time the loop is entered costs a compile.
+    bool isValidForeachItem(EvaluatorId id, const QString &item)
+    {
+        auto it = validForeachItems.constFind(id);
+        if (it == validForeachItems.constEnd()) {
+            const QJSValue check = assertEngine()->evaluate(
+                        QStringLiteral("(function(){var %1 = 0})()").arg(item));
+            it = validForeachItems.insert(id, !check.isError());
+        }
+        return *it;
+    }
+
+    // Assigns each element of array, and its index if requested, and runs body for it. The names
+    // of item and index are created once in the engine, instead of once per element.
+    bool runForeach(const QJSValue &array, const QString &item, const QString &index,
+                    const QString &context, QScxmlDataModel::ForeachLoopBody *body)
+    {
+        QV4::ExecutionEngine *engine = QJSValuePrivate::engine(&dataModel);
+        Q_ASSERT(engine);
+        QV4::Scope scope(engine);
+        QV4::ScopedString itemName(scope, engine->newString(item));
+        QV4::ScopedString indexName(scope);
+        const bool hasIndex = !index.isEmpty();
+        if (hasIndex)
+            indexName = engine->newString(index);
+        QV4::ScopedObject o(scope, QJSValuePrivate::asManagedType<QV4::Object>(&dataModel));
+        if (o == nullptr)
+            return checkSetProperty(SetPropertyFailedForAnotherReason, item, context);
+        QV4::ScopedValue v(scope);
+
+        const int length = array.property(QStringLiteral("length")).toInt();
+        for (int currentIndex = 0; currentIndex < length; ++currentIndex) {
+            v = QJSValuePrivate::convertToReturnedValue(
+                        engine, array.property(static_cast<quint32>(currentIndex)));
+            if (!checkSetProperty(setProperty(o, itemName, v), item, context))
+                return false;
+            if (hasIndex) {
+                v = QV4::Value::fromInt32(currentIndex);
+                if (!checkSetProperty(setProperty(o, indexName, v), index, context))
+                    return false;
+            }
+
+            bool ok = true;
+            body->run(&ok);
+            if (!ok)
+                return false;
+        }
+        return true;
+    }
+
+    bool checkSetProperty(SetPropertyResult result, const QString &name, const QString &context)
     {
         QString msg;
-        switch (setProperty(&dataModel, name, value)) {
+        switch (result) {
         case SetPropertySucceeded:
             return true;
         case SetReadOnlyPropertyFailed:
@@ -269,7 +475,8 @@ public:
     QStringList initialDataNames;
 
 private: // Uses private API
-    static void setReadonlyProperty(QJSValue *object, const QString &name, const QJSValue &value)
+    static void setReadonlyProperty(QJSValue *object, const QString &name, const QJSValue &value,
+                                    bool configurable = false)
     {
         qCDebug(qscxmlLog) << "setting read-only property" << name;
         QV4::ExecutionEngine *engine = QJSValuePrivate::engine(object);
@@ -293,18 +500,14 @@ private: // Uses private API
         }
 
         QV4::ScopedValue v(scope, QJSValuePrivate::convertToReturnedValue(engine, value));
-        o->defineReadonlyProperty(s, v);
+        if (configurable)
+            o->defineReadonlyConfigurableProperty(s, v);
+        else
+            o->defineReadonlyProperty(s, v);
         if (engine->hasException)
             engine->catchException();
     }
 
-    enum SetPropertyResult {
-        SetPropertySucceeded,
-        SetReadOnlyPropertyFailed,
-        SetUnknownPropertyFailed,
-        SetPropertyFailedForAnotherReason,
-    };
-
     static SetPropertyResult setProperty(QJSValue *object, const QString &name, const QJSValue &value)
     {
         QV4::ExecutionEngine *engine = QJSValuePrivate::engine(object);
@@ -325,9 +528,18 @@ private: // Uses private API
             return SetPropertyFailedForAnotherReason;
         }
 
+        QV4::ScopedValue v(scope, QJSValuePrivate::convertToReturnedValue(engine, value));
+        return setProperty(o, s, v);
+    }
+
+    static SetPropertyResult setProperty(QV4::Object *o, QV4::String *s, const QV4::Value &v)
+    {
+        QV4::ExecutionEngine *engine = o->engine();
+        if (engine->hasException)
+            return SetPropertyFailedForAnotherReason;
+
         QV4::PropertyAttributes attrs = o->getOwnProperty(s->toPropertyKey());
         if (attrs.isWritable() || attrs.isEmpty()) {
-            QV4::ScopedValue v(scope, QJSValuePrivate::convertToReturnedValue(engine, value));
             o->insertMember(s, v);
             if (engine->hasException) {
                 engine->catchException();
@@ -343,6 +555,11 @@ private: // Uses private API
 private:
     QJSEngine *jsEngine;
     QJSValue dataModel;
+
+    QScxmlPlatformProperties *platformProperties = nullptr;
+    QJSValue jsonParse;
+    QHash<EvaluatorId, bool> validForeachItems;
+    QSet<QString> builtins; // properties of the global object before the data model was set up
 };
 
 /*
@@ -371,7 +588,8 @@ bool QScxmlEcmaScriptDataModel::setup(const QVariantMap &initialDataValues)
     bool ok = true;
     QJSValue undefined(QJSValue::UndefinedValue); // See B.2.1, and test456.
     int count;
-    StringId *names = d->m_stateMachine->tableData()->dataNames(&count);
+    const StringId *names = QScxmlStateMachinePrivate::get(d->m_stateMachine.value())
+            ->dataNames(&count);
     for (int i = 0; i < count; ++i) {
         auto name = d->string(names[i]);
         QJSValue v = undefined;
@@ -393,7 +611,8 @@ QString QScxmlEcmaScriptDataModel::evaluateToString(QScxmlExecutableContent::Eva
                                                     bool *ok)
 {
     Q_D(QScxmlEcmaScriptDataModel);
-    const EvaluatorInfo &info = d->m_stateMachine->tableData()->evaluatorInfo(id);
+    const EvaluatorInfo info = QScxmlStateMachinePrivate::get(d->m_stateMachine.value())
+            ->evaluatorInfo(id);
 
     return d->evalStr(d->string(info.expr), d->string(info.context), ok);
 }
@@ -402,7 +621,8 @@ bool QScxmlEcmaScriptDataModel::evaluateToBool(QScxmlExecutableContent::Evaluato
                                                bool *ok)
 {
     Q_D(QScxmlEcmaScriptDataModel);
-    const EvaluatorInfo &info = d->m_stateMachine->tableData()->evaluatorInfo(id);
+    const EvaluatorInfo info = QScxmlStateMachinePrivate::get(d->m_stateMachine.value())
+            ->evaluatorInfo(id);
 
     return d->evalBool(d->string(info.expr), d->string(info.context), ok);
 }
@@ -411,7 +631,8 @@ QVariant QScxmlEcmaScriptDataModel::evaluateToVariant(QScxmlExecutableContent::E
                                                       bool *ok)
 {
     Q_D(QScxmlEcmaScriptDataModel);
-    const EvaluatorInfo &info = d->m_stateMachine->tableData()->evaluatorInfo(id);
+    const EvaluatorInfo info = QScxmlStateMachinePrivate::get(d->m_stateMachine.value())
+            ->evaluatorInfo(id);
 
     return d->evalJSValue(d->string(info.expr), d->string(info.context), ok).toVariant();
 }
@@ -420,7 +641,8 @@ void QScxmlEcmaScriptDataModel::evaluateToVoid(QScxmlExecutableContent::Evaluato
                                                bool *ok)
 {
     Q_D(QScxmlEcmaScriptDataModel);
-    const EvaluatorInfo &info = d->m_stateMachine->tableData()->evaluatorInfo(id);
+    const EvaluatorInfo info = QScxmlStateMachinePrivate::get(d->m_stateMachine.value())
+            ->evaluatorInfo(id);
 
     d->eval(d->string(info.expr), d->string(info.context), ok);
 }
@@ -431,7 +653,8 @@ void QScxmlEcmaScriptDataModel::evaluateAssignment(QScxmlExecutableContent::Eval
     Q_D(QScxmlEcmaScriptDataModel);
     Q_ASSERT(ok);
 
-    const AssignmentInfo &info = d->m_stateMachine->tableData()->assignmentInfo(id);
+    const AssignmentInfo info = QScxmlStateMachinePrivate::get(d->m_stateMachine.value())
+            ->assignmentInfo(id);
 
     QString dest = d->string(info.dest);
 
@@ -450,13 +673,22 @@ void QScxmlEcmaScriptDataModel::evaluateInitialization(QScxmlExecutableContent::
                                                        bool *ok)
 {
     Q_D(QScxmlEcmaScriptDataModel);
-    const AssignmentInfo &info = d->m_stateMachine->tableData()->assignmentInfo(id);
+    const AssignmentInfo info = QScxmlStateMachinePrivate::get(d->m_stateMachine.value())
+            ->assignmentInfo(id);
     QString dest = d->string(info.dest);
     if (d->initialDataNames.contains(dest)) {
         *ok = true; // silently ignore the <data> tag
         return;
     }
 
+    if (hasScxmlProperty(dest)) {
+        const QJSValue value = d->parseJsonLiteral(id, d->string(info.expr));
+        if (!value.isUndefined()) {
+            *ok = d->setProperty(dest, value, d->string(info.context));
+            return;
+        }
+    }
+
     evaluateAssignment(id, ok);
 }
 
@@ -466,7 +698,8 @@ void QScxmlEcmaScriptDataModel::evaluateForeach(QScxmlExecutableContent::Evaluat
     Q_D(QScxmlEcmaScriptDataModel);
     Q_ASSERT(ok);
     Q_ASSERT(body);
-    const ForeachInfo &info = d->m_stateMachine->tableData()->foreachInfo(id);
+    const ForeachInfo info = QScxmlStateMachinePrivate::get(d->m_stateMachine.value())
+            ->foreachInfo(id);
 
     QJSValue jsArray = d->property(d->string(info.array));
     if (!jsArray.isArray()) {
@@ -477,34 +710,14 @@ void QScxmlEcmaScriptDataModel::evaluateForeach(QScxmlExecutableContent::Evaluat
 
     QString item = d->string(info.item);
 
-    QJSEngine *engine = d->assertEngine();
-    if (engine->evaluate(QStringLiteral("(function(){var %1 = 0})()").arg(item)).isError()) {
+    if (!d->isValidForeachItem(id, item)) {
         d->submitError(QStringLiteral("error.execution"), QStringLiteral("invalid item '%1' in %2")
                       .arg(d->string(info.item), d->string(info.context)));
         *ok = false;
         return;
     }
 
-    const int length = jsArray.property(QStringLiteral("length")).toInt();
-    QString idx = d->string(info.index);
-    QString context = d->string(info.context);
-    const bool hasIndex = !idx.isEmpty();
-
-    for (int currentIndex = 0; currentIndex < length; ++currentIndex) {
-        QJSValue currentItem = jsArray.property(static_cast<quint32>(currentIndex));
-        *ok = d->setProperty(item, currentItem, context);
-        if (!*ok)
-            return;
-        if (hasIndex) {
-            *ok = d->setProperty(idx, currentIndex, context);
-            if (!*ok)
-                return;
-        }
-        body->run(ok);
-        if (!*ok)
-            return;
-    }
-    *ok = true;
+    *ok = d->runForeach(jsArray, item, d->string(info.index), d->string(info.context), body);
 }
 
 void QScxmlEcmaScriptDataModel::setScxmlEvent(const QScxmlEvent &event)
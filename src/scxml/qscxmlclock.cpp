@@ -0,0 +1,167 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtScxml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qscxmlclock_p.h"
+#include "qscxmlstatemachine_p.h"
+
+#include <QtCore/qcoreapplication.h>
+
+#include <algorithm>
+#include <limits>
+
+QT_BEGIN_NAMESPACE
+
+namespace QScxmlInternal {
+
+Clock::~Clock()
+{
+}
+
+// Pending delayed events are moved over to the new clock, with the time they still had left.
+// Passing nullptr goes back to the timers of the event loop.
+void Clock::setClock(QScxmlStateMachine *stateMachine, Clock *clock)
+{
+    QScxmlStateMachinePrivate::get(stateMachine)->setClock(clock);
+}
+
+Clock *Clock::clock(const QScxmlStateMachine *stateMachine)
+{
+    return QScxmlStateMachinePrivate::get(stateMachine)->m_clock;
+}
+
+void Clock::fire(QScxmlStateMachine *stateMachine, int timerId)
+{
+    QScxmlStateMachinePrivate::get(stateMachine)->delayTimerFired(timerId);
+}
+
+qint64 VirtualClock::currentTime() const
+{
+    return m_now;
+}
+
+int VirtualClock::startTimer(QScxmlStateMachine *stateMachine, int delay)
+{
+    Q_ASSERT(stateMachine);
+    if (m_lastId == std::numeric_limits<int>::max())
+        return 0;
+
+    const int id = ++m_lastId;
+    const qint64 dueTime = m_now + qMax(delay, 0);
+    m_timers.push_back({ dueTime, ++m_sequence, id, stateMachine });
+    std::push_heap(m_timers.begin(), m_timers.end());
+    m_pending.insert(id, dueTime);
+    return id;
+}
+
+void VirtualClock::killTimer(int timerId)
+{
+    if (!m_pending.remove(timerId))
+        return;
+
+    // The heap entry stays behind until it reaches the top, or until there are so many stale
+    // entries that a rebuild pays off.
+    if (m_timers.size() > 2 * size_t(m_pending.size()) + 16) {
+        m_timers.erase(std::remove_if(m_timers.begin(), m_timers.end(), [this](const Timer &timer) {
+                           return !m_pending.contains(timer.id);
+                       }), m_timers.end());
+        std::make_heap(m_timers.begin(), m_timers.end());
+    } else {
+        dropCancelled();
+    }
+}
+
+int VirtualClock::remainingTime(int timerId) const
+{
+    const auto it = m_pending.constFind(timerId);
+    if (it == m_pending.constEnd())
+        return -1;
+    return int(qMax(*it - m_now, qint64(0)));
+}
+
+qint64 VirtualClock::nextDueTime() const
+{
+    return m_timers.empty() ? -1 : m_timers.front().dueTime;
+}
+
+void VirtualClock::dropCancelled()
+{
+    while (!m_timers.empty() && !m_pending.contains(m_timers.front().id)) {
+        std::pop_heap(m_timers.begin(), m_timers.end());
+        m_timers.pop_back();
+    }
+}
+
+void VirtualClock::advance(qint64 msecs)
+{
+    advanceTo(m_now + qMax(msecs, qint64(0)));
+}
+
+void VirtualClock::advanceTo(qint64 time)
+{
+    // Whatever is posted already happens before any timer, as in the event loop. This also lets
+    // state machines that were just started send their first delayed events.
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::MetaCall);
+
+    while (!m_timers.empty() && m_timers.front().dueTime <= time) {
+        std::pop_heap(m_timers.begin(), m_timers.end());
+        const Timer timer = m_timers.back();
+        m_timers.pop_back();
+        m_pending.remove(timer.id);
+        dropCancelled();
+
+        m_now = qMax(m_now, timer.dueTime);
+        fire(timer.stateMachine, timer.id);
+        QCoreApplication::sendPostedEvents(nullptr, QEvent::MetaCall);
+    }
+
+    m_now = qMax(m_now, time);
+}
+
+bool VirtualClock::advanceToNext()
+{
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::MetaCall);
+    if (m_timers.empty())
+        return false;
+    advanceTo(m_timers.front().dueTime);
+    return true;
+}
+
+} // QScxmlInternal namespace
+
+QT_END_NAMESPACE
@@ -0,0 +1,144 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtScxml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QSCXMLCLOCK_P_H
+#define QSCXMLCLOCK_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtScxml/private/qscxmlglobals_p.h>
+#include <QtCore/qhash.h>
+
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+class QScxmlStateMachine;
+
+namespace QScxmlInternal {
+
+// The time source delayed events are scheduled with. By default a state machine uses timers of
+// the event loop of its thread. With a clock set, it asks the clock instead, and the clock calls
+// fire() when a delayed event is due. A clock can be shared by several state machines living in
+// the same thread. It is not owned by them and has to outlive them.
+//
+// This is private API, meant for tests and tools built against Qt SCXML. It only covers the
+// delayed events of QScxmlStateMachine. The timeouts of QStateMachine and of the QML
+// TimeoutTransition are scheduled in the Qt StateMachine modules, which don't depend on Qt SCXML,
+// and keep using the event loop's timers.
+class Q_SCXML_PRIVATE_EXPORT Clock
+{
+public:
+    virtual ~Clock();
+
+    // Milliseconds since an arbitrary, but fixed, point in time.
+    virtual qint64 currentTime() const = 0;
+
+    // Returns a positive id, or 0 if no timer can be started.
+    virtual int startTimer(QScxmlStateMachine *stateMachine, int delay) = 0;
+    virtual void killTimer(int timerId) = 0;
+    virtual int remainingTime(int timerId) const = 0;
+
+    static void setClock(QScxmlStateMachine *stateMachine, Clock *clock);
+    static Clock *clock(const QScxmlStateMachine *stateMachine);
+
+protected:
+    // Delivers the delayed event the timer was started for.
+    static void fire(QScxmlStateMachine *stateMachine, int timerId);
+};
+
+// A clock that only moves when told to. Advancing it delivers the delayed events that become due
+// one by one, in the order of their due times and, for equal due times, in the order they were
+// sent. After each of them the posted events of the thread are processed, as the event loop
+// would do between two timers. Hours of delays thereby pass in as long as it takes to process
+// the events, and the state machines see the same sequence of events as in real time.
+class Q_SCXML_PRIVATE_EXPORT VirtualClock : public Clock
+{
+public:
+    qint64 currentTime() const override;
+    int startTimer(QScxmlStateMachine *stateMachine, int delay) override;
+    void killTimer(int timerId) override;
+    int remainingTime(int timerId) const override;
+
+    // The time the next timer is due at, or -1 if there is none.
+    qint64 nextDueTime() const;
+
+    void advance(qint64 msecs);
+    void advanceTo(qint64 time);
+    // Advances to the next due time. Returns false if no timer is pending.
+    bool advanceToNext();
+
+private:
+    struct Timer
+    {
+        qint64 dueTime;
+        quint64 sequence;
+        int id;
+        QScxmlStateMachine *stateMachine;
+
+        bool operator<(const Timer &other) const
+        {
+            // Reversed, so that the heap has the earliest timer on top.
+            return dueTime != other.dueTime ? dueTime > other.dueTime : sequence > other.sequence;
+        }
+    };
+
+    void dropCancelled();
+
+    std::vector<Timer> m_timers; // heap, may contain killed timers below the top
+    QHash<int, qint64> m_pending; // id -> due time
+    qint64 m_now = 0;
+    quint64 m_sequence = 0;
+    int m_lastId = 0;
+};
+
+} // QScxmlInternal namespace
+
+QT_END_NAMESPACE
+
+#endif // QSCXMLCLOCK_P_H
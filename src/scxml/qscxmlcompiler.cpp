@@ -463,6 +463,215 @@ private:
     QList<DocumentModel::Node *> m_parentNodes;
 };
 
+// Rewrites a verified document into an equivalent one that generates smaller tables and evaluates
+// fewer conditions at runtime. States are left untouched, as they are visible through
+// QScxmlStateMachine::stateNames(), isActive() and the properties generated by qscxmlc. Only
+// transitions that can never be selected and executable content that can never run are removed.
+class DocumentOptimizer
+{
+public:
+    void optimize(DocumentModel::ScxmlDocument *doc)
+    {
+        for (DocumentModel::ScxmlDocument *subDoc : qAsConst(doc->allSubDocuments))
+            optimize(subDoc);
+
+        if (!doc->root)
+            return;
+
+        // "true" and "false" mean the same in ECMAScript and C++. The null data model only
+        // understands In(), so we leave its conditions alone.
+        m_canFold = doc->root->dataModel != DocumentModel::Scxml::NullDataModel;
+        m_deadTransitions.clear();
+
+        optimize(&doc->root->initialSetup);
+
+        for (DocumentModel::Transition *transition : qAsConst(doc->allTransitions))
+            optimize(&transition->instructionsOnTransition);
+
+        for (DocumentModel::AbstractState *abstractState : qAsConst(doc->allStates)) {
+            if (DocumentModel::State *state = abstractState->asState()) {
+                // Only the transitions of a state are selected by their condition. Initial and
+                // history transitions are referenced from elsewhere, so they have to stay.
+                for (DocumentModel::StateOrTransition *child : qAsConst(state->children)) {
+                    if (DocumentModel::Transition *transition = child->asTransition())
+                        foldCondition(transition);
+                }
+                optimize(state->onEntry);
+                optimize(state->onExit);
+                for (DocumentModel::Invoke *invoke : qAsConst(state->invokes))
+                    optimize(&invoke->finalize);
+                removeDeadTransitions(state->children);
+            }
+        }
+
+        if (!m_deadTransitions.isEmpty()) {
+            doc->allTransitions.removeIf([this](DocumentModel::Transition *transition) {
+                return m_deadTransitions.contains(transition);
+            });
+        }
+    }
+
+private:
+    enum Constant { NotConstant, AlwaysFalse, AlwaysTrue };
+
+    void foldCondition(DocumentModel::Transition *transition)
+    {
+        if (!transition->condition)
+            return;
+        switch (constantValue(*transition->condition)) {
+        case AlwaysTrue:
+            transition->condition.reset();
+            break;
+        case AlwaysFalse:
+            m_deadTransitions.insert(transition);
+            break;
+        case NotConstant:
+            break;
+        }
+    }
+
+    Constant constantValue(const QString &condition) const
+    {
+        if (!m_canFold)
+            return NotConstant;
+        const QString trimmed = condition.trimmed();
+        if (trimmed == QStringLiteral("true"))
+            return AlwaysTrue;
+        if (trimmed == QStringLiteral("false"))
+            return AlwaysFalse;
+        return NotConstant;
+    }
+
+    void optimize(const DocumentModel::InstructionSequences &sequences)
+    {
+        for (DocumentModel::InstructionSequence *sequence : sequences)
+            optimize(sequence);
+    }
+
+    void optimize(DocumentModel::InstructionSequence *sequence)
+    {
+        for (int i = 0; i < sequence->size(); ) {
+            DocumentModel::Instruction *instruction = sequence->at(i);
+            if (DocumentModel::If *ifInstruction = instruction->asIf()) {
+                DocumentModel::InstructionSequence *replacement = nullptr;
+                if (fold(ifInstruction, &replacement)) {
+                    sequence->removeAt(i);
+                    if (replacement) {
+                        for (DocumentModel::Instruction *inlined : qAsConst(*replacement))
+                            sequence->insert(i++, inlined);
+                    }
+                    continue;
+                }
+            } else if (DocumentModel::Foreach *loop = instruction->asForeach()) {
+                optimize(&loop->block);
+            }
+            ++i;
+        }
+    }
+
+    // Drops the branches of an <if> that can never be taken. Returns true if the <if> itself can
+    // be replaced by the instructions in *replacement, or removed if that is nullptr.
+    bool fold(DocumentModel::If *node, DocumentModel::InstructionSequence **replacement)
+    {
+        optimize(node->blocks);
+
+        const bool hasElse = node->blocks.size() > node->conditions.size();
+        DocumentModel::InstructionSequence *otherwise = hasElse ? node->blocks.last() : nullptr;
+        QStringList conditions;
+        DocumentModel::InstructionSequences blocks;
+        for (int i = 0, ei = node->conditions.size(); i != ei; ++i) {
+            const Constant value = constantValue(node->conditions.at(i));
+            if (value == AlwaysFalse)
+                continue;
+            if (value == AlwaysTrue) {
+                otherwise = node->blocks.at(i);
+                break;
+            }
+            conditions.append(node->conditions.at(i));
+            blocks.append(node->blocks.at(i));
+        }
+
+        if (conditions.isEmpty()) {
+            *replacement = otherwise;
+            return true;
+        }
+
+        if (otherwise)
+            blocks.append(otherwise);
+        node->conditions = conditions;
+        node->blocks = blocks;
+        return false;
+    }
+
+    // A transition is dead if its condition is constant false, or if an earlier unconditional
+    // transition of the same state matches every event it matches. Transitions are selected in
+    // document order per state, so the earlier one would always win.
+    void removeDeadTransitions(QList<DocumentModel::StateOrTransition *> &children)
+    {
+        bool hasUnconditionalEventless = false;
+        QStringList unconditionalDescriptors;
+        children.removeIf([&](DocumentModel::StateOrTransition *child) {
+            DocumentModel::Transition *transition = child->asTransition();
+            if (!transition)
+                return false;
+
+            bool dead = m_deadTransitions.contains(transition);
+            if (!dead) {
+                if (transition->events.isEmpty()) {
+                    dead = hasUnconditionalEventless;
+                } else {
+                    dead = std::all_of(transition->events.cbegin(), transition->events.cend(),
+                                       [&](const QString &descriptor) {
+                        return isCovered(descriptor, unconditionalDescriptors);
+                    });
+                }
+            }
+
+            if (dead) {
+                m_deadTransitions.insert(transition);
+                return true;
+            }
+
+            if (!transition->condition) {
+                if (transition->events.isEmpty())
+                    hasUnconditionalEventless = true;
+                else
+                    unconditionalDescriptors.append(transition->events);
+            }
+            return false;
+        });
+    }
+
+    // Mirrors QScxmlStateMachinePrivate::nameMatch(): returns true if every event name matched by
+    // descriptor is also matched by one of the descriptors in coveredBy.
+    static bool isCovered(QString descriptor, const QStringList &coveredBy)
+    {
+        const QString any = QStringLiteral("*");
+        const QString anySuffix = QStringLiteral(".*");
+        if (descriptor.endsWith(anySuffix))
+            descriptor.chop(2);
+        for (QString prefix : coveredBy) {
+            if (prefix == any)
+                return true;
+            if (descriptor == any)
+                continue;
+            if (prefix.endsWith(anySuffix))
+                prefix.chop(2);
+            if (!descriptor.startsWith(prefix))
+                continue;
+            if (descriptor.size() == prefix.size())
+                return true;
+            const QChar next = descriptor.at(prefix.size());
+            if (next == QLatin1Char('.') || next == QLatin1Char('('))
+                return true;
+        }
+        return false;
+    }
+
+    bool m_canFold = false;
+    QSet<DocumentModel::Transition *> m_deadTransitions;
+};
+
 #ifndef BUILD_QSCXMLC
 class InvokeDynamicScxmlFactory: public QScxmlInvokableServiceFactory
 {
@@ -617,29 +826,62 @@ public:
     QScxmlInvokableServiceFactory *serviceFactory(int id) const override final
     { return m_allFactoriesById.at(id); }
 
-    static DynamicStateMachine *build(DocumentModel::ScxmlDocument *doc)
+    struct FactoryInfo
     {
-        auto stateMachine = new DynamicStateMachine;
+        QScxmlExecutableContent::InvokeInfo invokeInfo;
+        QList<QScxmlExecutableContent::StringId> namelist;
+        QList<QScxmlExecutableContent::ParameterInfo> params;
+        QSharedPointer<DocumentModel::ScxmlDocument> content;
+    };
+
+    // Everything build() produces that does not involve QObjects, so it can be created on a
+    // different thread than the state machine.
+    struct Tables
+    {
+        GeneratedTableData tableData;
         MetaDataInfo info;
+        QList<FactoryInfo> factories;
+    };
+
+    static void buildTables(DocumentModel::ScxmlDocument *doc, Tables *tables)
+    {
         DataModelInfo dm;
-        auto factoryIdCreator = [stateMachine](
+        auto factoryIdCreator = [tables](
                 const QScxmlExecutableContent::InvokeInfo &invokeInfo,
                 const QList<QScxmlExecutableContent::StringId> &namelist,
                 const QList<QScxmlExecutableContent::ParameterInfo> &params,
                 const QSharedPointer<DocumentModel::ScxmlDocument> &content) -> int {
-            auto factory = new InvokeDynamicScxmlFactory(invokeInfo, namelist, params);
-            factory->setContent(content);
-            stateMachine->m_allFactoriesById.append(factory);
-            return stateMachine->m_allFactoriesById.size() - 1;
+            tables->factories.append({ invokeInfo, namelist, params, content });
+            return tables->factories.size() - 1;
         };
 
-        GeneratedTableData::build(doc, stateMachine, &info, &dm, factoryIdCreator);
+        GeneratedTableData::build(doc, &tables->tableData, &tables->info, &dm, factoryIdCreator);
+    }
+
+    static DynamicStateMachine *build(const Tables &tables)
+    {
+        auto stateMachine = new DynamicStateMachine;
+        static_cast<GeneratedTableData &>(*stateMachine) = tables.tableData;
+        for (const FactoryInfo &factoryInfo : tables.factories) {
+            auto factory = new InvokeDynamicScxmlFactory(factoryInfo.invokeInfo,
+                                                         factoryInfo.namelist, factoryInfo.params);
+            factory->setContent(factoryInfo.content);
+            stateMachine->m_allFactoriesById.append(factory);
+        }
+
         stateMachine->setTableData(stateMachine);
-        stateMachine->initDynamicParts(info);
+        stateMachine->initDynamicParts(tables.info);
 
         return stateMachine;
     }
 
+    static DynamicStateMachine *build(DocumentModel::ScxmlDocument *doc)
+    {
+        Tables tables;
+        buildTables(doc, &tables);
+        return build(tables);
+    }
+
 private:
     static QList<QByteArray> init(const char *s)
     {
@@ -663,16 +905,23 @@ inline QScxmlInvokableService *InvokeDynamicScxmlFactory::invoke(
     if (!ok)
         return nullptr;
 
+    // The source has to be loaded again on each invocation, as srcexpr can change.
     if (!srcexpr.isEmpty())
         return invokeDynamicScxmlService(srcexpr, parentStateMachine, this);
 
+    if (QScxmlScxmlService *recycled = takeRecycledScxmlService(this, parentStateMachine))
+        return recycled;
+
     auto childStateMachine = DynamicStateMachine::build(m_content.data());
 
     auto dm = QScxmlDataModelPrivate::instantiateDataModel(m_content->root->dataModel);
     dm->setParent(childStateMachine);
     childStateMachine->setDataModel(dm);
 
-    return invokeStaticScxmlService(childStateMachine, parentStateMachine, this);
+    QScxmlScxmlService *service = invokeStaticScxmlService(childStateMachine, parentStateMachine,
+                                                           this);
+    service->setRecyclable(true);
+    return service;
 }
 #endif // BUILD_QSCXMLC
 
@@ -813,7 +1062,8 @@ QScxmlStateMachine *QScxmlCompiler::compile()
         // Only verify the document if there were no parse errors: if there were any, the document
         // is incomplete and will contain errors for sure. There is no need to heap more errors on
         // top of other errors.
-        d->verifyDocument();
+        if (d->verifyDocument())
+            d->optimizeDocument();
     }
     return d->instantiateStateMachine();
 }
@@ -825,63 +1075,114 @@ QScxmlStateMachine *QScxmlCompiler::compile()
  * If parsing is successful, the returned state machine can be initialized and started. If
  * parsing fails, QScxmlStateMachine::parseErrors() can be used to retrieve a list of errors.
  *
- * \note The instantiated state machine will not have an associated data model set.
- * \sa QScxmlCompilerPrivate::instantiateDataModel
+ * \sa QScxmlCompilerPrivate::prepareStateMachine
  */
 QScxmlStateMachine *QScxmlCompilerPrivate::instantiateStateMachine() const
 {
 #ifdef BUILD_QSCXMLC
     return nullptr;
 #else // BUILD_QSCXMLC
-    DocumentModel::ScxmlDocument *doc = scxmlDocument();
-    if (doc && doc->root) {
-        auto stateMachine = DynamicStateMachine::build(doc);
-        instantiateDataModel(stateMachine);
-        return stateMachine;
-    } else {
-        class InvalidStateMachine: public QScxmlStateMachine {
-        public:
-            InvalidStateMachine() : QScxmlStateMachine(&QScxmlStateMachine::staticMetaObject)
-            {}
-        };
-
-        auto stateMachine = new InvalidStateMachine;
-        QScxmlStateMachinePrivate::get(stateMachine)->parserData()->m_errors = errors();
-        instantiateDataModel(stateMachine);
-        return stateMachine;
-    }
+    return prepareStateMachine().instantiate();
 #endif // BUILD_QSCXMLC
 }
 
+#ifndef BUILD_QSCXMLC
+namespace QScxmlInternal {
+class PreparedStateMachineData
+{
+public:
+    QList<QScxmlError> errors;
+    bool hasRoot = false;
+    DocumentModel::Scxml::DataModelType dataModel = DocumentModel::Scxml::NullDataModel;
+    DynamicStateMachine::Tables tables;
+};
+
+PreparedStateMachine::PreparedStateMachine() = default;
+PreparedStateMachine::~PreparedStateMachine() = default;
+
 /*!
  * \internal
- * Instantiates the data model as described in the SCXML file.
+ * Parses, verifies and builds the tables for the SCXML document in \a data. \a fileName is used
+ * for error reporting and for resolving relative URIs. This does not create any QObjects and can
+ * therefore be done on any thread.
+ */
+PreparedStateMachine PreparedStateMachine::prepare(const QByteArray &data,
+                                                   const QString &fileName)
+{
+    QXmlStreamReader reader(data);
+    QScxmlCompiler compiler(&reader);
+    compiler.setFileName(fileName);
+    QScxmlCompilerPrivate *compilerPrivate = QScxmlCompilerPrivate::get(&compiler);
+    compilerPrivate->readDocument();
+    if (compilerPrivate->errors().isEmpty() && compilerPrivate->verifyDocument())
+        compilerPrivate->optimizeDocument();
+    return compilerPrivate->prepareStateMachine();
+}
+
+/*!
+ * \internal
+ * Creates the state machine and its data model on the current thread.
  *
- * After instantiation, the \a stateMachine takes ownership of the data model.
+ * If there were parse errors, the returned state machine cannot be started and the errors can be
+ * retrieved with QScxmlStateMachine::parseErrors().
  */
-void QScxmlCompilerPrivate::instantiateDataModel(QScxmlStateMachine *stateMachine) const
+QScxmlStateMachine *PreparedStateMachine::instantiate() const
 {
-#ifdef BUILD_QSCXMLC
-    Q_UNUSED(stateMachine);
-#else
-    if (!m_errors.isEmpty()) {
-        qWarning() << "SCXML document has errors";
-        return;
+    Q_ASSERT(d);
+
+    QScxmlStateMachine *stateMachine = nullptr;
+    if (d->errors.isEmpty() && d->hasRoot) {
+        stateMachine = DynamicStateMachine::build(d->tables);
+    } else {
+        class InvalidStateMachine: public QScxmlStateMachine {
+        public:
+            InvalidStateMachine() : QScxmlStateMachine(&QScxmlStateMachine::staticMetaObject)
+            {}
+        };
+
+        stateMachine = new InvalidStateMachine;
+        QScxmlStateMachinePrivate::get(stateMachine)->parserData()->m_errors = d->errors;
     }
 
-    auto doc = scxmlDocument();
-    auto root = doc ? doc->root : nullptr;
-    if (root == nullptr) {
+    if (!d->errors.isEmpty()) {
+        qWarning() << "SCXML document has errors";
+    } else if (!d->hasRoot) {
         qWarning() << "SCXML document has no root element";
     } else {
-        QScxmlDataModel *dm = QScxmlDataModelPrivate::instantiateDataModel(root->dataModel);
+        QScxmlDataModel *dm = QScxmlDataModelPrivate::instantiateDataModel(d->dataModel);
         QScxmlStateMachinePrivate::get(stateMachine)->parserData()->m_ownedDataModel.reset(dm);
         stateMachine->setDataModel(dm);
         if (dm == nullptr)
             qWarning() << "No data-model instantiated";
     }
-#endif // BUILD_QSCXMLC
+
+    return stateMachine;
+}
+} // QScxmlInternal namespace
+
+/*!
+ * \internal
+ * Captures the parsed SCXML in a form that can be instantiated on another thread.
+ *
+ * \sa QScxmlInternal::PreparedStateMachine::instantiate
+ */
+QScxmlInternal::PreparedStateMachine QScxmlCompilerPrivate::prepareStateMachine() const
+{
+    auto data = QSharedPointer<QScxmlInternal::PreparedStateMachineData>::create();
+    data->errors = errors();
+
+    DocumentModel::ScxmlDocument *doc = scxmlDocument();
+    if (doc && doc->root) {
+        data->hasRoot = true;
+        data->dataModel = doc->root->dataModel;
+        DynamicStateMachine::buildTables(doc, &data->tables);
+    }
+
+    QScxmlInternal::PreparedStateMachine prepared;
+    prepared.d = data;
+    return prepared;
 }
+#endif // BUILD_QSCXMLC
 
 /*!
  * Returns the list of parse errors.
@@ -1361,6 +1662,17 @@ bool QScxmlCompilerPrivate::verifyDocument()
         return false;
 }
 
+/*!
+ * \internal
+ * Removes transitions and executable content that can never run from a verified document. This
+ * must only be called when verifyDocument() succeeded.
+ */
+void QScxmlCompilerPrivate::optimizeDocument()
+{
+    if (m_doc)
+        DocumentOptimizer().optimize(m_doc.get());
+}
+
 DocumentModel::ScxmlDocument *QScxmlCompilerPrivate::scxmlDocument() const
 {
     return m_doc && m_errors.isEmpty() ? m_doc.get() : nullptr;
@@ -1420,7 +1732,7 @@ bool QScxmlCompilerPrivate::preReadElementScxml()
         addError(QLatin1String("Doc root already allocated"));
         return false;
     }
-    m_doc->root = new DocumentModel::Scxml(xmlLocation());
+    m_doc->root = m_doc->newNode<DocumentModel::Scxml>(xmlLocation());
 
     auto scxml = m_doc->root;
     const QXmlStreamAttributes attributes = m_reader->attributes();
@@ -1547,10 +1859,12 @@ bool QScxmlCompilerPrivate::preReadElementTransition()
     }
 
     const QXmlStreamAttributes attributes = m_reader->attributes();
-    transition->events = attributes.value(QLatin1String("event")).toString().split(QLatin1Char(' '), Qt::SkipEmptyParts);
-    transition->targets = attributes.value(QLatin1String("target")).toString().split(QLatin1Char(' '), Qt::SkipEmptyParts);
-    if (attributes.hasAttribute(QStringLiteral("cond")))
-        transition->condition.reset(new QString(attributes.value(QLatin1String("cond")).toString()));
+    transition->events = m_doc->internList(attributes.value(QLatin1String("event")));
+    transition->targets = m_doc->internList(attributes.value(QLatin1String("target")));
+    if (attributes.hasAttribute(QStringLiteral("cond"))) {
+        const QString cond = m_doc->intern(attributes.value(QLatin1String("cond")));
+        transition->condition.reset(new QString(cond));
+    }
     QStringView type = attributes.value(QLatin1String("type"));
     if (type.isEmpty() || type == QLatin1String("external")) {
         transition->type = DocumentModel::Transition::External;
@@ -1642,7 +1956,7 @@ bool QScxmlCompilerPrivate::preReadElementRaise()
 {
     const QXmlStreamAttributes attributes = m_reader->attributes();
     auto raise = m_doc->newNode<DocumentModel::Raise>(xmlLocation());
-    raise->event = attributes.value(QLatin1String("event")).toString();
+    raise->event = m_doc->intern(attributes.value(QLatin1String("event")));
     current().instruction = raise;
     return true;
 }
@@ -1652,7 +1966,7 @@ bool QScxmlCompilerPrivate::preReadElementIf()
     const QXmlStreamAttributes attributes = m_reader->attributes();
     auto *ifI = m_doc->newNode<DocumentModel::If>(xmlLocation());
     current().instruction = ifI;
-    ifI->conditions.append(attributes.value(QLatin1String("cond")).toString());
+    ifI->conditions.append(m_doc->intern(attributes.value(QLatin1String("cond"))));
     current().instructionContainer = m_doc->newSequence(&ifI->blocks);
     return true;
 }
@@ -1665,7 +1979,7 @@ bool QScxmlCompilerPrivate::preReadElementElseIf()
     if (!ifI)
         return false;
 
-    ifI->conditions.append(attributes.value(QLatin1String("cond")).toString());
+    ifI->conditions.append(m_doc->intern(attributes.value(QLatin1String("cond"))));
     previous().instructionContainer = m_doc->newSequence(&ifI->blocks);
     return true;
 }
@@ -1684,9 +1998,9 @@ bool QScxmlCompilerPrivate::preReadElementForeach()
 {
     const QXmlStreamAttributes attributes = m_reader->attributes();
     auto foreachI = m_doc->newNode<DocumentModel::Foreach>(xmlLocation());
-    foreachI->array = attributes.value(QLatin1String("array")).toString();
-    foreachI->item = attributes.value(QLatin1String("item")).toString();
-    foreachI->index = attributes.value(QLatin1String("index")).toString();
+    foreachI->array = m_doc->intern(attributes.value(QLatin1String("array")));
+    foreachI->item = m_doc->intern(attributes.value(QLatin1String("item")));
+    foreachI->index = m_doc->intern(attributes.value(QLatin1String("index")));
     current().instruction = foreachI;
     current().instructionContainer = &foreachI->block;
     return true;
@@ -1696,8 +2010,8 @@ bool QScxmlCompilerPrivate::preReadElementLog()
 {
     const QXmlStreamAttributes attributes = m_reader->attributes();
     auto logI = m_doc->newNode<DocumentModel::Log>(xmlLocation());
-    logI->label = attributes.value(QLatin1String("label")).toString();
-    logI->expr = attributes.value(QLatin1String("expr")).toString();
+    logI->label = m_doc->intern(attributes.value(QLatin1String("label")));
+    logI->expr = m_doc->intern(attributes.value(QLatin1String("expr")));
     current().instruction = logI;
     return true;
 }
@@ -1711,9 +2025,9 @@ bool QScxmlCompilerPrivate::preReadElementData()
 {
     const QXmlStreamAttributes attributes = m_reader->attributes();
     auto data = m_doc->newNode<DocumentModel::DataElement>(xmlLocation());
-    data->id = attributes.value(QLatin1String("id")).toString();
-    data->src = attributes.value(QLatin1String("src")).toString();
-    data->expr = attributes.value(QLatin1String("expr")).toString();
+    data->id = m_doc->intern(attributes.value(QLatin1String("id")));
+    data->src = m_doc->intern(attributes.value(QLatin1String("src")));
+    data->expr = m_doc->intern(attributes.value(QLatin1String("expr")));
     if (DocumentModel::Scxml *scxml = m_currentState->asScxml()) {
         scxml->dataElements.append(data);
     } else if (DocumentModel::State *state = m_currentState->asState()) {
@@ -1728,8 +2042,8 @@ bool QScxmlCompilerPrivate::preReadElementAssign()
 {
     const QXmlStreamAttributes attributes = m_reader->attributes();
     auto assign = m_doc->newNode<DocumentModel::Assign>(xmlLocation());
-    assign->location = attributes.value(QLatin1String("location")).toString();
-    assign->expr = attributes.value(QLatin1String("expr")).toString();
+    assign->location = m_doc->intern(attributes.value(QLatin1String("location")));
+    assign->expr = m_doc->intern(attributes.value(QLatin1String("expr")));
     current().instruction = assign;
     return true;
 }
@@ -1757,12 +2071,12 @@ bool QScxmlCompilerPrivate::preReadElementContent()
     case ParserState::DoneData: {
         DocumentModel::State *s = m_currentState->asState();
         Q_ASSERT(s);
-        s->doneData->expr = attributes.value(QLatin1String("expr")).toString();
+        s->doneData->expr = m_doc->intern(attributes.value(QLatin1String("expr")));
     } break;
     case ParserState::Send: {
         DocumentModel::Send *s = previous().instruction->asSend();
         Q_ASSERT(s);
-        s->contentexpr = attributes.value(QLatin1String("expr")).toString();
+        s->contentexpr = m_doc->intern(attributes.value(QLatin1String("expr")));
     } break;
     case ParserState::Invoke: {
         DocumentModel::Invoke *i = previous().instruction->asInvoke();
@@ -1783,9 +2097,9 @@ bool QScxmlCompilerPrivate::preReadElementParam()
 {
     const QXmlStreamAttributes attributes = m_reader->attributes();
     auto param = m_doc->newNode<DocumentModel::Param>(xmlLocation());
-    param->name = attributes.value(QLatin1String("name")).toString();
-    param->expr = attributes.value(QLatin1String("expr")).toString();
-    param->location = attributes.value(QLatin1String("location")).toString();
+    param->name = m_doc->intern(attributes.value(QLatin1String("name")));
+    param->expr = m_doc->intern(attributes.value(QLatin1String("expr")));
+    param->location = m_doc->intern(attributes.value(QLatin1String("location")));
 
     ParserState::Kind previousKind = previous().kind;
     switch (previousKind) {
@@ -1815,7 +2129,7 @@ bool QScxmlCompilerPrivate::preReadElementScript()
 {
     const QXmlStreamAttributes attributes = m_reader->attributes();
     auto *script = m_doc->newNode<DocumentModel::Script>(xmlLocation());
-    script->src = attributes.value(QLatin1String("src")).toString();
+    script->src = m_doc->intern(attributes.value(QLatin1String("src")));
     current().instruction = script;
     return true;
 }
@@ -1824,18 +2138,18 @@ bool QScxmlCompilerPrivate::preReadElementSend()
 {
     const QXmlStreamAttributes attributes = m_reader->attributes();
     auto *send = m_doc->newNode<DocumentModel::Send>(xmlLocation());
-    send->event = attributes.value(QLatin1String("event")).toString();
-    send->eventexpr = attributes.value(QLatin1String("eventexpr")).toString();
-    send->delay = attributes.value(QLatin1String("delay")).toString();
-    send->delayexpr = attributes.value(QLatin1String("delayexpr")).toString();
-    send->id = attributes.value(QLatin1String("id")).toString();
-    send->idLocation = attributes.value(QLatin1String("idlocation")).toString();
-    send->type = attributes.value(QLatin1String("type")).toString();
-    send->typeexpr = attributes.value(QLatin1String("typeexpr")).toString();
-    send->target = attributes.value(QLatin1String("target")).toString();
-    send->targetexpr = attributes.value(QLatin1String("targetexpr")).toString();
+    send->event = m_doc->intern(attributes.value(QLatin1String("event")));
+    send->eventexpr = m_doc->intern(attributes.value(QLatin1String("eventexpr")));
+    send->delay = m_doc->intern(attributes.value(QLatin1String("delay")));
+    send->delayexpr = m_doc->intern(attributes.value(QLatin1String("delayexpr")));
+    send->id = m_doc->intern(attributes.value(QLatin1String("id")));
+    send->idLocation = m_doc->intern(attributes.value(QLatin1String("idlocation")));
+    send->type = m_doc->intern(attributes.value(QLatin1String("type")));
+    send->typeexpr = m_doc->intern(attributes.value(QLatin1String("typeexpr")));
+    send->target = m_doc->intern(attributes.value(QLatin1String("target")));
+    send->targetexpr = m_doc->intern(attributes.value(QLatin1String("targetexpr")));
     if (attributes.hasAttribute(QLatin1String("namelist")))
-        send->namelist = attributes.value(QLatin1String("namelist")).toString().split(QLatin1Char(' '), Qt::SkipEmptyParts);
+        send->namelist = m_doc->internList(attributes.value(QLatin1String("namelist")));
     current().instruction = send;
     return true;
 }
@@ -1844,8 +2158,8 @@ bool QScxmlCompilerPrivate::preReadElementCancel()
 {
     const QXmlStreamAttributes attributes = m_reader->attributes();
     auto *cancel = m_doc->newNode<DocumentModel::Cancel>(xmlLocation());
-    cancel->sendid = attributes.value(QLatin1String("sendid")).toString();
-    cancel->sendidexpr = attributes.value(QLatin1String("sendidexpr")).toString();
+    cancel->sendid = m_doc->intern(attributes.value(QLatin1String("sendid")));
+    cancel->sendidexpr = m_doc->intern(attributes.value(QLatin1String("sendidexpr")));
     current().instruction = cancel;
     return true;
 }
@@ -1861,12 +2175,12 @@ bool QScxmlCompilerPrivate::preReadElementInvoke()
     }
     auto *invoke = m_doc->newNode<DocumentModel::Invoke>(xmlLocation());
     parentState->invokes.append(invoke);
-    invoke->src = attributes.value(QLatin1String("src")).toString();
-    invoke->srcexpr = attributes.value(QLatin1String("srcexpr")).toString();
-    invoke->id = attributes.value(QLatin1String("id")).toString();
-    invoke->idLocation = attributes.value(QLatin1String("idlocation")).toString();
-    invoke->type = attributes.value(QLatin1String("type")).toString();
-    invoke->typeexpr = attributes.value(QLatin1String("typeexpr")).toString();
+    invoke->src = m_doc->intern(attributes.value(QLatin1String("src")));
+    invoke->srcexpr = m_doc->intern(attributes.value(QLatin1String("srcexpr")));
+    invoke->id = m_doc->intern(attributes.value(QLatin1String("id")));
+    invoke->idLocation = m_doc->intern(attributes.value(QLatin1String("idlocation")));
+    invoke->type = m_doc->intern(attributes.value(QLatin1String("type")));
+    invoke->typeexpr = m_doc->intern(attributes.value(QLatin1String("typeexpr")));
     QStringView autoforwardS = attributes.value(QLatin1String("autoforward"));
     if (autoforwardS.compare(QLatin1String("true"), Qt::CaseInsensitive) == 0
             || autoforwardS.compare(QLatin1String("yes"), Qt::CaseInsensitive) == 0
@@ -1876,7 +2190,7 @@ bool QScxmlCompilerPrivate::preReadElementInvoke()
         invoke->autoforward = true;
     else
         invoke->autoforward = false;
-    invoke->namelist = attributes.value(QLatin1String("namelist")).toString().split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    invoke->namelist = m_doc->internList(attributes.value(QLatin1String("namelist")));
     current().instruction = invoke;
     return true;
 }
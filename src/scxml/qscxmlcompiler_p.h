@@ -55,6 +55,7 @@
 
 #include <QtCore/qdir.h>
 #include <QtCore/qfileinfo.h>
+#include <QtCore/qhash.h>
 #include <QtCore/qset.h>
 #include <QtCore/qsharedpointer.h>
 #include <QtCore/qstringlist.h>
@@ -77,6 +78,7 @@ struct XmlLocation
 };
 
 struct If;
+struct Foreach;
 struct Send;
 struct Invoke;
 struct Script;
@@ -94,6 +96,7 @@ struct Node {
     virtual void accept(NodeVisitor *visitor) = 0;
 
     virtual If *asIf() { return nullptr; }
+    virtual Foreach *asForeach() { return nullptr; }
     virtual Send *asSend() { return nullptr; }
     virtual Invoke *asInvoke() { return nullptr; }
     virtual Script *asScript() { return nullptr; }
@@ -244,6 +247,7 @@ struct Foreach: public Instruction
     InstructionSequence block;
 
     Foreach(const XmlLocation &xmlLocation): Instruction(xmlLocation) {}
+    Foreach *asForeach() override { return this; }
     void accept(NodeVisitor *visitor) override;
 };
 
@@ -404,6 +408,45 @@ struct Scxml: public StateContainer, public Node
     void accept(NodeVisitor *visitor) override;
 };
 
+// A bump allocator for the nodes of one document. Objects are never freed individually: the
+// document runs their destructors and then releases all blocks at once.
+class Arena
+{
+public:
+    Arena() = default;
+    ~Arena()
+    {
+        for (char *block : qAsConst(m_blocks))
+            ::operator delete(block);
+    }
+
+    template<typename T, typename... Args>
+    T *create(Args &&...args)
+    {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+private:
+    void *allocate(size_t size, size_t alignment)
+    {
+        size_t offset = (m_used + alignment - 1) & ~(alignment - 1);
+        if (m_blocks.isEmpty() || offset + size > m_blockSize) {
+            m_blockSize = std::max(size, size_t(BlockSize));
+            m_blocks.append(static_cast<char *>(::operator new(m_blockSize)));
+            offset = 0;
+        }
+        m_used = offset + size;
+        return m_blocks.last() + offset;
+    }
+
+    enum { BlockSize = 16 * 1024 };
+    QList<char *> m_blocks;
+    size_t m_blockSize = 0;
+    size_t m_used = 0;
+
+    Q_DISABLE_COPY(Arena)
+};
+
 struct ScxmlDocument
 {
     const QString fileName;
@@ -423,9 +466,35 @@ struct ScxmlDocument
 
     ~ScxmlDocument()
     {
-        delete root;
-        qDeleteAll(allNodes);
-        qDeleteAll(allSequences);
+        for (Node *node : qAsConst(allNodes))
+            node->~Node();
+        for (InstructionSequence *sequence : qAsConst(allSequences))
+            sequence->~InstructionSequence();
+    }
+
+    // Attribute values repeat a lot (event names, targets, locations), so all of them share one
+    // copy per document.
+    QString intern(QStringView str)
+    {
+        if (str.isEmpty())
+            return QString();
+
+        auto it = internedStrings.constFind(str);
+        if (it == internedStrings.constEnd()) {
+            const QString copy = str.toString();
+            it = internedStrings.insert(copy, copy);
+        }
+        return *it;
+    }
+
+    QStringList internList(QStringView str)
+    {
+        QStringList result;
+        const auto parts = str.split(QLatin1Char(' '), Qt::SkipEmptyParts);
+        result.reserve(parts.size());
+        for (QStringView part : parts)
+            result.append(intern(part));
+        return result;
     }
 
     State *newState(StateContainer *parent, State::Type type, const XmlLocation &xmlLocation)
@@ -462,7 +531,7 @@ struct ScxmlDocument
     template<typename T>
     T *newNode(const XmlLocation &xmlLocation)
     {
-        T *node = new T(xmlLocation);
+        T *node = arena.create<T>(xmlLocation);
         allNodes.append(node);
         return node;
     }
@@ -470,11 +539,17 @@ struct ScxmlDocument
     InstructionSequence *newSequence(InstructionSequences *container)
     {
         Q_ASSERT(container);
-        InstructionSequence *is = new InstructionSequence;
+        InstructionSequence *is = arena.create<InstructionSequence>();
         allSequences.append(is);
         container->append(is);
         return is;
     }
+
+private:
+    Arena arena;
+    QHash<QStringView, QString> internedStrings; // the keys point into the values
+
+    Q_DISABLE_COPY(ScxmlDocument)
 };
 
 class Q_SCXML_EXPORT NodeVisitor
@@ -552,6 +627,31 @@ public:
 
 } // DocumentModel namespace
 
+#ifndef BUILD_QSCXMLC
+namespace QScxmlInternal {
+class PreparedStateMachineData;
+
+// The thread-independent part of compiling an SCXML document: parsing, verification and table
+// generation. It can be created on any thread and handed to the thread that is to own the state
+// machine, where instantiate() only has to create the QObjects.
+class Q_SCXML_EXPORT PreparedStateMachine
+{
+public:
+    PreparedStateMachine();
+    ~PreparedStateMachine();
+
+    static PreparedStateMachine prepare(const QByteArray &data, const QString &fileName);
+
+    bool isNull() const { return d.isNull(); }
+    QScxmlStateMachine *instantiate() const;
+
+private:
+    friend class QT_PREPEND_NAMESPACE(QScxmlCompilerPrivate);
+    QSharedPointer<const PreparedStateMachineData> d;
+};
+} // QScxmlInternal namespace
+#endif // BUILD_QSCXMLC
+
 class Q_SCXML_EXPORT QScxmlCompilerPrivate
 {
 public:
@@ -560,6 +660,7 @@ public:
     QScxmlCompilerPrivate(QXmlStreamReader *reader);
 
     bool verifyDocument();
+    void optimizeDocument();
     DocumentModel::ScxmlDocument *scxmlDocument() const;
 
     QString fileName() const;
@@ -582,7 +683,9 @@ public:
     void addError(const QString &msg);
     void addError(const DocumentModel::XmlLocation &location, const QString &msg);
     QScxmlStateMachine *instantiateStateMachine() const;
-    void instantiateDataModel(QScxmlStateMachine *stateMachine) const;
+#ifndef BUILD_QSCXMLC
+    QScxmlInternal::PreparedStateMachine prepareStateMachine() const;
+#endif
 
 private:
     DocumentModel::AbstractState *currentParent() const;
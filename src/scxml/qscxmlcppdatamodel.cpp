@@ -79,7 +79,8 @@ class TheDataModel: public QScxmlCppDataModel
    methods whose implementation is generated by the Qt SCXML compiler.
 
    The Qt SCXML compiler will generate the various \c evaluateTo methods, and convert expressions and
-   scripts into lambdas inside those methods. For example:
+   scripts into member functions of the data model that those methods call through a table. For
+   example:
    \code
 <scxml datamodel="cplusplus:TheDataModel:thedatamodel.h" xmlns="http://www.w3.org/2005/07/scxml" version="1.0" name="MediaPlayerStateMachine">
     <state id="stopped">
@@ -100,30 +101,30 @@ class TheDataModel: public QScxmlCppDataModel
    \endcode
    This will result in:
    \code
-bool TheDataModel::evaluateToBool(QScxmlExecutableContent::EvaluatorId id, bool *ok) {
-    // ....
-        return [this]()->bool{ return isValidMedia(); }();
-    // ....
-}
+template <>
+bool TheDataModel::qt_scxmlEvaluate<bool, 1>()
+{ return isValidMedia(); }
 
-QVariant TheDataModel::evaluateToVariant(QScxmlExecutableContent::EvaluatorId id, bool *ok) {
-    // ....
-        return [this]()->QVariant{ return media; }();
-    // ....
-}
+template <>
+QVariant TheDataModel::qt_scxmlEvaluate<QVariant, 3>()
+{ return media; }
 
-void TheDataModel::evaluateToVoid(QScxmlExecutableContent::EvaluatorId id, bool *ok) {
-    // ....
-        [this]()->void{ media = eventData().value(QStringLiteral("media")).toString(); }();
-    // ....
-}
+template <>
+void TheDataModel::qt_scxmlEvaluate<void, 2>()
+{ media = eventData().value(QStringLiteral("media")).toString(); }
    \endcode
 
    So, you are not limited to call functions. In a \c <script> element you can put zero or more C++
    statements, and in \e cond or \e expr attributes you can use any C++ expression that can be
-   converted to the respective bool or QVariant. And, as the \c this pointer is also captured, you
+   converted to the respective bool or QVariant. And, as the code runs in a member function, you
    can call or access the data model (the \e media attribute in the example above). For the full
    example, see \l {Qt SCXML: Media Player QML Example (C++ Data Model)}.
+
+   Events submitted from C++ can carry a payload of any registered type. Such a payload can be read
+   with QScxmlEvent::typedData() on scxmlEvent(), which neither converts nor copies it:
+   \code
+        if (auto *m = scxmlEvent().typedData<Media>()) media = m->url;
+   \endcode
  */
 
 /*!
@@ -273,4 +274,29 @@ bool QScxmlCppDataModel::inState(const QString &stateName) const
     return stateMachine()->isActive(stateName);
 }
 
+/*!
+  \class QScxmlCppDataModel::EvaluatorTable
+  \inmodule QtScxml
+  \since 6.4
+
+  \brief The EvaluatorTable struct holds the evaluators generated for a C++ data model.
+
+  For each kind of result, there is an array of member function pointers indexed by
+  evaluator ID. Entries for evaluators of a different kind are \c nullptr. The tables are
+  static constants generated by the Qt SCXML compiler, so that the state machine can
+  evaluate conditions without going through evaluateToBool().
+ */
+
+/*!
+  \since 6.4
+
+  Returns the evaluator table generated for this data model, or \c nullptr if there is
+  none. The Q_SCXML_DATAMODEL macro declares an override, which the Qt SCXML compiler
+  implements.
+ */
+const QScxmlCppDataModel::EvaluatorTable *QScxmlCppDataModel::evaluatorTable() const
+{
+    return nullptr;
+}
+
 QT_END_NAMESPACE
@@ -48,6 +48,15 @@
         bool evaluateToBool(QScxmlExecutableContent::EvaluatorId id, bool *ok) override final; \
         QVariant evaluateToVariant(QScxmlExecutableContent::EvaluatorId id, bool *ok) override final; \
         void evaluateToVoid(QScxmlExecutableContent::EvaluatorId id, bool *ok) override final; \
+    protected: \
+        const QScxmlCppDataModel::EvaluatorTable *evaluatorTable() const override final; \
+    private: \
+        template <typename T, QScxmlExecutableContent::EvaluatorId Id> T qt_scxmlEvaluate(); \
+        static const QScxmlCppDataModel::EvaluatorTable::StringEvaluator qt_scxmlStringEvaluators[]; \
+        static const QScxmlCppDataModel::EvaluatorTable::BoolEvaluator qt_scxmlBoolEvaluators[]; \
+        static const QScxmlCppDataModel::EvaluatorTable::VariantEvaluator qt_scxmlVariantEvaluators[]; \
+        static const QScxmlCppDataModel::EvaluatorTable::VoidEvaluator qt_scxmlVoidEvaluators[]; \
+        static const QScxmlCppDataModel::EvaluatorTable qt_scxmlEvaluators; \
     private:
 
 QT_BEGIN_NAMESPACE
@@ -60,6 +69,23 @@ class Q_SCXML_EXPORT QScxmlCppDataModel: public QScxmlDataModel
 public:
     explicit QScxmlCppDataModel(QObject *parent = nullptr);
 
+    struct EvaluatorTable
+    {
+        typedef QString (QScxmlCppDataModel::*StringEvaluator)();
+        typedef bool (QScxmlCppDataModel::*BoolEvaluator)();
+        typedef QVariant (QScxmlCppDataModel::*VariantEvaluator)();
+        typedef void (QScxmlCppDataModel::*VoidEvaluator)();
+
+        const StringEvaluator *stringEvaluators;
+        int stringEvaluatorCount;
+        const BoolEvaluator *boolEvaluators;
+        int boolEvaluatorCount;
+        const VariantEvaluator *variantEvaluators;
+        int variantEvaluatorCount;
+        const VoidEvaluator *voidEvaluators;
+        int voidEvaluatorCount;
+    };
+
     Q_INVOKABLE bool setup(const QVariantMap &initialDataValues) override;
 
     void evaluateAssignment(QScxmlExecutableContent::EvaluatorId id, bool *ok) override;
@@ -74,6 +100,9 @@ public:
     bool setScxmlProperty(const QString &name, const QVariant &value, const QString &context) override;
 
     bool inState(const QString &stateName) const;
+
+protected:
+    virtual const EvaluatorTable *evaluatorTable() const;
 };
 
 QT_END_NAMESPACE
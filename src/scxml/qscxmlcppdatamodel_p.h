@@ -60,6 +60,12 @@ QT_BEGIN_NAMESPACE
 class Q_SCXML_EXPORT QScxmlCppDataModelPrivate : public QScxmlDataModelPrivate
 {
 public:
+    static QScxmlCppDataModelPrivate *get(QScxmlCppDataModel *dataModel)
+    { return dataModel->d_func(); }
+
+    static const QScxmlCppDataModel::EvaluatorTable *evaluatorTable(QScxmlCppDataModel *dataModel)
+    { return dataModel->evaluatorTable(); }
+
     QScxmlEvent event;
 };
 
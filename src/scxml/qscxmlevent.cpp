@@ -41,6 +41,7 @@
 #include "qscxmlevent_p.h"
 #include "qscxmlstatemachine_p.h"
 
+#include <qdatastream.h>
 #include <qjsondocument.h>
 #include <qjsonobject.h>
 
@@ -50,10 +51,46 @@ using namespace QScxmlExecutableContent;
 
 QAtomicInt QScxmlEventBuilder::idCounter = QAtomicInt(0);
 
+QScxmlEventBuilder::QScxmlEventBuilder(QScxmlStateMachine *stateMachine, const QString &eventName,
+                                       const DoneData *doneData)
+{
+    init();
+    this->stateMachine = stateMachine;
+    auto stateMachinePrivate = QScxmlStateMachinePrivate::get(stateMachine);
+    Q_ASSERT(doneData);
+    instructionLocation = doneData->location;
+    event = eventName;
+    contents = stateMachinePrivate->string(doneData->contents);
+    contentExpr = doneData->expr;
+    params = &doneData->params;
+    eventType = QScxmlEvent::InternalEvent;
+}
+
+QScxmlEventBuilder::QScxmlEventBuilder(QScxmlStateMachine *stateMachine, const Send &send)
+{
+    init();
+    this->stateMachine = stateMachine;
+    auto stateMachinePrivate = QScxmlStateMachinePrivate::get(stateMachine);
+    instructionLocation = send.instructionLocation;
+    event = stateMachinePrivate->string(send.event);
+    eventexpr = send.eventexpr;
+    contents = stateMachinePrivate->string(send.content);
+    contentExpr = send.contentexpr;
+    params = send.params();
+    id = stateMachinePrivate->string(send.id);
+    idLocation = stateMachinePrivate->string(send.idLocation);
+    target = stateMachinePrivate->string(send.target);
+    targetexpr = send.targetexpr;
+    type = stateMachinePrivate->string(send.type);
+    typeexpr = send.typeexpr;
+    namelist = &send.namelist;
+}
+
 QScxmlEvent *QScxmlEventBuilder::buildEvent()
 {
     auto dataModel = stateMachine ? stateMachine->dataModel() : nullptr;
-    auto tableData = stateMachine ? stateMachine->tableData() : nullptr;
+    auto stateMachinePrivate = stateMachine ? QScxmlStateMachinePrivate::get(stateMachine)
+                                            : nullptr;
 
     QString eventName = event;
     bool ok = true;
@@ -78,7 +115,7 @@ QScxmlEvent *QScxmlEventBuilder::buildEvent()
         if (evaluate(params, stateMachine, keyValues)) {
             if (namelist) {
                 for (qint32 i = 0; i < namelist->count; ++i) {
-                    QString name = tableData->string(namelist->const_data()[i]);
+                    QString name = stateMachinePrivate->string(namelist->const_data()[i]);
                     keyValues.insert(name, dataModel->scxmlProperty(name));
                 }
             }
@@ -93,7 +130,8 @@ QScxmlEvent *QScxmlEventBuilder::buildEvent()
     QString sendid = id;
     if (!idLocation.isEmpty()) {
         sendid = generateId();
-        ok = stateMachine->dataModel()->setScxmlProperty(idLocation, sendid, tableData->string(instructionLocation));
+        ok = stateMachine->dataModel()->setScxmlProperty(
+                    idLocation, sendid, stateMachinePrivate->string(instructionLocation));
         if (!ok)
             return nullptr;
     }
@@ -114,14 +152,14 @@ QScxmlEvent *QScxmlEventBuilder::buildEvent()
         // [6.2.4] and test194.
         submitError(QStringLiteral("error.execution"),
                     QStringLiteral("Error in %1: %2 is not a legal target")
-                    .arg(tableData->string(instructionLocation), origin),
+                    .arg(stateMachinePrivate->string(instructionLocation), origin),
                     sendid);
         return nullptr;
     } else if (!stateMachine->isDispatchableTarget(origin)) {
         // [6.2.4] and test521.
         submitError(QStringLiteral("error.communication"),
                     QStringLiteral("Error in %1: cannot dispatch to target '%2'")
-                    .arg(tableData->string(instructionLocation), origin),
+                    .arg(stateMachinePrivate->string(instructionLocation), origin),
                     sendid);
         return nullptr;
     }
@@ -141,7 +179,7 @@ QScxmlEvent *QScxmlEventBuilder::buildEvent()
         // [6.2.5] and test199
         submitError(QStringLiteral("error.execution"),
                     QStringLiteral("Error in %1: %2 is not a valid type")
-                    .arg(tableData->string(instructionLocation), origintype),
+                    .arg(stateMachinePrivate->string(instructionLocation), origintype),
                     sendid);
         return nullptr;
     }
@@ -180,17 +218,17 @@ bool QScxmlEventBuilder::evaluate(const ParameterInfo &param, QScxmlStateMachine
                                   QVariantMap &keyValues)
 {
     auto dataModel = stateMachine->dataModel();
-    auto tableData = stateMachine->tableData();
+    auto stateMachinePrivate = QScxmlStateMachinePrivate::get(stateMachine);
     if (param.expr != NoEvaluator) {
         bool success = false;
         auto v = dataModel->evaluateToVariant(param.expr, &success);
-        keyValues.insert(tableData->string(param.name), v);
+        keyValues.insert(stateMachinePrivate->string(param.name), v);
         return success;
     }
 
     QString loc;
     if (param.location != QScxmlExecutableContent::NoString) {
-        loc = tableData->string(param.location);
+        loc = stateMachinePrivate->string(param.location);
     }
 
     if (loc.isEmpty()) {
@@ -198,7 +236,7 @@ bool QScxmlEventBuilder::evaluate(const ParameterInfo &param, QScxmlStateMachine
     }
 
     if (dataModel->hasScxmlProperty(loc)) {
-        keyValues.insert(tableData->string(param.name), dataModel->scxmlProperty(loc));
+        keyValues.insert(stateMachinePrivate->string(param.name), dataModel->scxmlProperty(loc));
         return true;
     } else {
         submitError(QStringLiteral("error.execution"),
@@ -543,6 +581,46 @@ void QScxmlEvent::setData(const QVariant &data)
         d->data = data;
 }
 
+/*!
+ * \since 6.4
+ *
+ * Returns a pointer to the payload data if it is of the given \a type, or
+ * \c nullptr otherwise. The data is not converted or copied, so this is the
+ * cheapest way for a C++ data model to read a payload of a known type. The
+ * pointer stays valid as long as the event is not modified or destroyed.
+ *
+ * The payload is stored in a QVariant, which is implicitly shared. Events
+ * carrying large structs can therefore be copied without copying the
+ * struct.
+ *
+ * \sa QScxmlEvent::data
+ */
+const void *QScxmlEvent::typedData(QMetaType type) const
+{
+    if (isErrorEvent() || d->data.metaType() != type)
+        return nullptr;
+    return d->data.constData();
+}
+
+/*!
+ * \fn template <typename T> const T *QScxmlEvent::typedData() const
+ * \since 6.4
+ *
+ * Returns a pointer to the payload data if it is of type \c T, or \c nullptr
+ * otherwise.
+ *
+ * \code
+ * struct Reading { double value; qint64 timestamp; };
+ * Q_DECLARE_METATYPE(Reading)
+ *
+ * stateMachine->submitEvent("reading", QVariant::fromValue(Reading{ 21.5, now }));
+ *
+ * // In a QScxmlCppDataModel subclass:
+ * if (const Reading *reading = scxmlEvent().typedData<Reading>())
+ *     m_lastValue = reading->value;
+ * \endcode
+ */
+
 /*!
     \property QScxmlEvent::errorEvent
     \brief Whether the event represents an error.
@@ -606,4 +684,36 @@ QByteArray QScxmlEventPrivate::debugString(QScxmlEvent *event)
     return QJsonDocument(o).toJson(QJsonDocument::Compact);
 }
 
+void QScxmlEventPrivate::write(QDataStream &stream, const QScxmlEvent *event)
+{
+    stream << event->name() << qint8(event->eventType()) << event->sendId() << event->origin()
+           << event->originType() << event->invokeId() << qint32(event->delay())
+           << event->data();
+}
+
+// Returns nullptr if the stream does not contain a valid event.
+QScxmlEvent *QScxmlEventPrivate::read(QDataStream &stream)
+{
+    QString name, sendId, origin, originType, invokeId;
+    qint8 eventType = 0;
+    qint32 delay = 0;
+    QVariant data;
+    stream >> name >> eventType >> sendId >> origin >> originType >> invokeId >> delay >> data;
+    if (stream.status() != QDataStream::Ok || eventType < QScxmlEvent::PlatformEvent
+            || eventType > QScxmlEvent::ExternalEvent) {
+        return nullptr;
+    }
+
+    auto event = new QScxmlEvent;
+    event->setName(name);
+    event->setEventType(QScxmlEvent::EventType(eventType));
+    event->setSendId(sendId);
+    event->setOrigin(origin);
+    event->setOriginType(originType);
+    event->setInvokeId(invokeId);
+    event->setDelay(delay);
+    event->setData(data);
+    return event;
+}
+
 QT_END_NAMESPACE
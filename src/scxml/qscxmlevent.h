@@ -106,6 +106,11 @@ public:
     QVariant data() const;
     void setData(const QVariant &data);
 
+    const void *typedData(QMetaType type) const;
+    template <typename T>
+    const T *typedData() const
+    { return static_cast<const T *>(typedData(QMetaType::fromType<T>())); }
+
     bool isErrorEvent() const;
     QString errorMessage() const;
     void setErrorMessage(const QString &message);
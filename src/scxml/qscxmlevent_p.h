@@ -62,6 +62,8 @@
 
 QT_BEGIN_NAMESPACE
 
+class QDataStream;
+
 #ifndef BUILD_QSCXMLC
 class QScxmlEventBuilder
 {
@@ -105,37 +107,10 @@ class QScxmlEventBuilder
     }
 
 public:
-    QScxmlEventBuilder(QScxmlStateMachine *stateMachine, const QString &eventName, const QScxmlExecutableContent::DoneData *doneData)
-    {
-        init();
-        this->stateMachine = stateMachine;
-        Q_ASSERT(doneData);
-        instructionLocation = doneData->location;
-        event = eventName;
-        contents = stateMachine->tableData()->string(doneData->contents);
-        contentExpr = doneData->expr;
-        params = &doneData->params;
-        eventType = QScxmlEvent::InternalEvent;
-    }
-
-    QScxmlEventBuilder(QScxmlStateMachine *stateMachine, const QScxmlExecutableContent::Send &send)
-    {
-        init();
-        this->stateMachine = stateMachine;
-        instructionLocation = send.instructionLocation;
-        event = stateMachine->tableData()->string(send.event);
-        eventexpr = send.eventexpr;
-        contents = stateMachine->tableData()->string(send.content);
-        contentExpr = send.contentexpr;
-        params = send.params();
-        id = stateMachine->tableData()->string(send.id);
-        idLocation = stateMachine->tableData()->string(send.idLocation);
-        target = stateMachine->tableData()->string(send.target);
-        targetexpr = send.targetexpr;
-        type = stateMachine->tableData()->string(send.type);
-        typeexpr = send.typeexpr;
-        namelist = &send.namelist;
-    }
+    QScxmlEventBuilder(QScxmlStateMachine *stateMachine, const QString &eventName,
+                       const QScxmlExecutableContent::DoneData *doneData);
+    QScxmlEventBuilder(QScxmlStateMachine *stateMachine,
+                       const QScxmlExecutableContent::Send &send);
 
     QScxmlEvent *operator()() { return buildEvent(); }
 
@@ -173,6 +148,10 @@ public:
     int delayInMiliSecs;
 
     static QByteArray debugString(QScxmlEvent *event);
+
+    // Binary form of an event, as used by snapshots and event logs.
+    static void write(QDataStream &stream, const QScxmlEvent *event);
+    static QScxmlEvent *read(QDataStream &stream);
 };
 
 QT_END_NAMESPACE
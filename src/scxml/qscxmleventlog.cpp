@@ -0,0 +1,198 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtScxml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qscxmleventlog_p.h"
+#include "qscxmlevent_p.h"
+#include "qscxmlstatemachine_p.h"
+
+QT_BEGIN_NAMESPACE
+
+namespace QScxmlInternal {
+
+enum : quint32 { EventLogMagic = 0x5343584c }; // "SCXL"
+enum : quint16 { EventLogVersion = 1 };
+static const QDataStream::Version EventLogStreamVersion = QDataStream::Qt_6_0;
+
+bool EventLogWriter::open(const QString &fileName, QScxmlStateMachine *stateMachine)
+{
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(EventLogStreamVersion);
+    m_stream << quint32(EventLogMagic) << quint16(EventLogVersion) << stateMachine->name();
+
+    // A state machine that has already started is picked up from where it is now.
+    const bool hasSnapshot = stateMachine->isInitialized();
+    m_stream << hasSnapshot;
+    if (hasSnapshot && !stateMachine->saveSnapshot(&m_file))
+        return false;
+
+    m_clock.start();
+    return m_file.flush() && m_stream.status() == QDataStream::Ok;
+}
+
+void EventLogWriter::writeRecordHeader(EventLog::RecordType type)
+{
+    m_stream << quint8(type) << quint64(m_clock.nsecsElapsed());
+    m_hasRecords = true;
+}
+
+void EventLogWriter::writeEvent(EventLog::RecordType type, const QScxmlEvent *event)
+{
+    writeRecordHeader(type);
+    QScxmlEventPrivate::write(m_stream, event);
+}
+
+void EventLogWriter::writeDelayedEventFired(int index)
+{
+    writeRecordHeader(EventLog::DelayedEventFired);
+    m_stream << qint32(index);
+}
+
+// Only macrosteps that follow new records matter for the replay. The file is flushed here, so
+// that little is lost if the process dies, without a system call per event.
+void EventLogWriter::writeMacrostep()
+{
+    if (!m_hasRecords)
+        return;
+    writeRecordHeader(EventLog::Macrostep);
+    m_hasRecords = false;
+    m_file.flush();
+}
+
+bool EventLog::startRecording(QScxmlStateMachine *stateMachine, const QString &fileName)
+{
+    auto smp = QScxmlStateMachinePrivate::get(stateMachine);
+    if (smp->m_isProcessingEvents || smp->m_replaying)
+        return false;
+
+    std::unique_ptr<EventLogWriter> writer(new EventLogWriter);
+    if (!writer->open(fileName, stateMachine))
+        return false;
+    smp->m_eventLog = std::move(writer);
+    return true;
+}
+
+void EventLog::stopRecording(QScxmlStateMachine *stateMachine)
+{
+    QScxmlStateMachinePrivate::get(stateMachine)->m_eventLog.reset();
+}
+
+bool EventLog::replay(QScxmlStateMachine *stateMachine, const QString &fileName)
+{
+    auto smp = QScxmlStateMachinePrivate::get(stateMachine);
+    if (smp->m_isProcessingEvents || smp->m_replaying || smp->m_eventLog)
+        return false;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QByteArray contents;
+    if (const uchar *data = file.map(0, file.size()))
+        contents = QByteArray::fromRawData(reinterpret_cast<const char *>(data), file.size());
+    else
+        contents = file.readAll();
+
+    QDataStream stream(contents);
+    stream.setVersion(EventLogStreamVersion);
+    quint32 magic = 0;
+    quint16 version = 0;
+    QString name;
+    bool hasSnapshot = false;
+    stream >> magic >> version >> name >> hasSnapshot;
+    if (stream.status() != QDataStream::Ok || magic != EventLogMagic
+            || version != EventLogVersion || name != stateMachine->name()) {
+        return false;
+    }
+
+    smp->m_replaying = true;
+    bool ok = false;
+    if (hasSnapshot) {
+        ok = stateMachine->restoreSnapshot(stream.device());
+    } else if (stateMachine->isInitialized() || stateMachine->init()) {
+        stateMachine->start();
+        ok = true;
+    }
+
+    while (ok && !stream.atEnd()) {
+        quint8 type = 0;
+        quint64 time = 0;
+        stream >> type >> time;
+        switch (type) {
+        case Macrostep:
+            smp->processEvents();
+            break;
+        case SubmittedEvent:
+        case ServiceEvent:
+            if (QScxmlEvent *event = QScxmlEventPrivate::read(stream)) {
+                if (type == SubmittedEvent)
+                    smp->submitEvent(event);
+                else
+                    smp->postEvent(event);
+            } else {
+                ok = false;
+            }
+            break;
+        case DelayedEventFired: {
+            qint32 index = -1;
+            stream >> index;
+            ok = index >= 0 && size_t(index) < smp->m_delayedEvents.size();
+            if (ok)
+                smp->fireDelayedEvent(size_t(index));
+            break;
+        }
+        default:
+            ok = false;
+            break;
+        }
+        ok = ok && stream.status() == QDataStream::Ok;
+    }
+
+    if (ok)
+        smp->processEvents();
+    smp->m_replaying = false;
+    smp->restartDelayTimers();
+    return ok;
+}
+
+} // QScxmlInternal namespace
+
+QT_END_NAMESPACE
@@ -0,0 +1,116 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtScxml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QSCXMLEVENTLOG_P_H
+#define QSCXMLEVENTLOG_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtScxml/private/qscxmlglobals_p.h>
+#include <QtCore/qdatastream.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qfile.h>
+
+QT_BEGIN_NAMESPACE
+
+class QScxmlEvent;
+class QScxmlStateMachine;
+
+namespace QScxmlInternal {
+
+// Records what reaches a state machine from outside, so that the same run can be replayed later.
+// As the interpreter is deterministic, this is the events submitted through the public API, the
+// events from invoked services, the delayed events becoming due, and the points where a
+// macrostep starts. Events the state machine sends to itself are not recorded, as the replay
+// produces them again.
+//
+// A log starts with a header and, if the state machine was already running when the recording
+// started, a snapshot of it. Each record then consists of its type, the time in nanoseconds since
+// the recording started, and the data of the record.
+class Q_SCXML_PRIVATE_EXPORT EventLog
+{
+public:
+    enum RecordType : quint8 {
+        Macrostep,         // no data
+        SubmittedEvent,    // the event
+        ServiceEvent,      // the event
+        DelayedEventFired  // index of the event among the pending delayed events
+    };
+
+    static bool startRecording(QScxmlStateMachine *stateMachine, const QString &fileName);
+    static void stopRecording(QScxmlStateMachine *stateMachine);
+
+    // Drives the state machine with the records in the log, as fast as possible. The state
+    // machine has to be created from the same document as the recorded one, and must not have
+    // processed any events yet. While the log is replayed, delayed events are only delivered
+    // when the log says so, and events from anywhere else are ignored.
+    static bool replay(QScxmlStateMachine *stateMachine, const QString &fileName);
+};
+
+class EventLogWriter
+{
+public:
+    bool open(const QString &fileName, QScxmlStateMachine *stateMachine);
+    void writeEvent(EventLog::RecordType type, const QScxmlEvent *event);
+    void writeDelayedEventFired(int index);
+    void writeMacrostep();
+
+private:
+    void writeRecordHeader(EventLog::RecordType type);
+
+    QFile m_file;
+    QDataStream m_stream;
+    QElapsedTimer m_clock;
+    bool m_hasRecords = false; // since the last macrostep
+};
+
+} // QScxmlInternal namespace
+
+QT_END_NAMESPACE
+
+#endif // QSCXMLEVENTLOG_P_H
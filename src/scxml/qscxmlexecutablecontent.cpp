@@ -42,6 +42,10 @@
 #include "qscxmlcompiler_p.h"
 #include "qscxmlevent_p.h"
 
+#ifndef BUILD_QSCXMLC
+#include "qscxmlstatemachine_p.h"
+#endif // BUILD_QSCXMLC
+
 QT_BEGIN_NAMESPACE
 
 using namespace QScxmlExecutableContent;
@@ -283,7 +287,7 @@ bool QScxmlExecutionEngine::execute(ContainerId id, const QVariant &extraData)
     if (id == NoInstruction)
         return true;
 
-    const InstructionId *ip = stateMachine->tableData()->instructions() + id;
+    const InstructionId *ip = QScxmlStateMachinePrivate::get(stateMachine)->instructions() + id;
     this->extraData = extraData;
     bool result = true;
     step(ip, &result);
@@ -294,7 +298,7 @@ bool QScxmlExecutionEngine::execute(ContainerId id, const QVariant &extraData)
 const InstructionId *QScxmlExecutionEngine::step(const InstructionId *ip, bool *ok)
 {
     auto dataModel = stateMachine->dataModel();
-    auto tableData = stateMachine->tableData();
+    auto stateMachinePrivate = QScxmlStateMachinePrivate::get(stateMachine);
 
     *ok = true;
     auto instr = reinterpret_cast<const Instruction *>(ip);
@@ -334,7 +338,7 @@ const InstructionId *QScxmlExecutionEngine::step(const InstructionId *ip, bool *
         const Send *send = reinterpret_cast<const Send *>(instr);
         ip += send->size();
 
-        QString delay = tableData->string(send->delay);
+        QString delay = stateMachinePrivate->string(send->delay);
         if (send->delayexpr != NoEvaluator) {
             delay = stateMachine->dataModel()->evaluateToString(send->delayexpr, ok);
             if (!(*ok))
@@ -358,7 +362,7 @@ const InstructionId *QScxmlExecutionEngine::step(const InstructionId *ip, bool *
             }
         }
 
-        stateMachine->submitEvent(event);
+        stateMachinePrivate->submitEvent(event);
         return ip;
     }
 
@@ -422,11 +426,11 @@ const InstructionId *QScxmlExecutionEngine::step(const InstructionId *ip, bool *
         qCDebug(qscxmlLog) << stateMachine << "Executing raise step";
         const Raise *raise = reinterpret_cast<const Raise *>(instr);
         ip += raise->size();
-        auto name = tableData->string(raise->event);
+        auto name = stateMachinePrivate->string(raise->event);
         auto event = new QScxmlEvent;
         event->setName(name);
         event->setEventType(QScxmlEvent::InternalEvent);
-        stateMachine->submitEvent(event);
+        stateMachinePrivate->submitEvent(event);
         return ip;
     }
 
@@ -441,7 +445,7 @@ const InstructionId *QScxmlExecutionEngine::step(const InstructionId *ip, bool *
                 qCWarning(qscxmlLog) << stateMachine << "Could not evaluate <log> expr to string.";
         }
 
-        const QString label = tableData->string(log->label);
+        const QString label = stateMachinePrivate->string(log->label);
         qCDebug(scxmlLog) << label << ":" << str;
         QMetaObject::invokeMethod(stateMachine,
                                   "log",
@@ -455,7 +459,7 @@ const InstructionId *QScxmlExecutionEngine::step(const InstructionId *ip, bool *
         qCDebug(qscxmlLog) << stateMachine << "Executing cancel step";
         const Cancel *cancel = reinterpret_cast<const Cancel *>(instr);
         ip += cancel->size();
-        QString e = tableData->string(cancel->sendid);
+        QString e = stateMachinePrivate->string(cancel->sendid);
         if (cancel->sendidexpr != NoEvaluator)
             e = dataModel->evaluateToString(cancel->sendidexpr, ok);
         if (*ok && !e.isEmpty())
@@ -488,7 +492,7 @@ const InstructionId *QScxmlExecutionEngine::step(const InstructionId *ip, bool *
         auto e = event();
         e->setEventType(QScxmlEvent::InternalEvent);
         qCDebug(qscxmlLog) << stateMachine << "submitting event" << eventName;
-        stateMachine->submitEvent(e);
+        stateMachinePrivate->submitEvent(e);
         return ip;
     }
 
@@ -41,6 +41,9 @@
 #include "qscxmlinvokableservice_p.h"
 #include "qscxmlstatemachine_p.h"
 
+#include <QtCore/qmutex.h>
+#include <QtCore/qthread.h>
+
 QT_BEGIN_NAMESPACE
 
 /*!
@@ -239,6 +242,10 @@ QString QScxmlInvokableServicePrivate::calculateId(
     *ok = true;
     auto stateMachine = parent->tableData();
 
+    // The location in the parent's data model was restored along with the snapshot.
+    if (!restoredId.isEmpty())
+        return restoredId;
+
     if (invokeInfo.id != QScxmlExecutableContent::NoString) {
         return stateMachine->string(invokeInfo.id);
     }
@@ -317,9 +324,55 @@ QVariantMap QScxmlInvokableServicePrivate::calculateData(
     return result;
 }
 
+namespace {
+// The threads that state machines invoked with QScxmlStateMachine::threadedInvocation run on. The
+// threads are started on first use, and the child state machines are spread over them in turn.
+class InvokeThreadPool
+{
+public:
+    ~InvokeThreadPool()
+    {
+        for (QThread *thread : std::as_const(m_threads)) {
+            thread->quit();
+            thread->wait();
+            delete thread;
+        }
+    }
+
+    QThread *nextThread()
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_threads.isEmpty()) {
+            const int count = qMax(1, QThread::idealThreadCount());
+            for (int i = 0; i < count; ++i) {
+                auto thread = new QThread;
+                thread->setObjectName(QStringLiteral("QScxmlInvoke-%1").arg(i));
+                thread->start();
+                m_threads.append(thread);
+            }
+        }
+        return m_threads.at(m_next++ % m_threads.size());
+    }
+
+private:
+    QMutex m_mutex;
+    QList<QThread *> m_threads;
+    qsizetype m_next = 0;
+};
+
+Q_GLOBAL_STATIC(InvokeThreadPool, invokeThreadPool)
+} // anonymous namespace
+
 QScxmlScxmlService::~QScxmlScxmlService()
 {
-    delete m_stateMachine;
+    if (m_toParent) {
+        // The state machine may still be busy on its worker thread. Drop whatever it sends from
+        // now on, and let it be deleted on its own thread.
+        m_toParent->close();
+        m_stateMachine->deleteLater();
+    } else {
+        delete m_stateMachine;
+    }
 }
 
 /*!
@@ -356,6 +409,23 @@ bool QScxmlScxmlService::start()
         return false;
 
     QScxmlStateMachinePrivate::get(m_stateMachine)->m_sessionId = id;
+
+    if (m_toChild) {
+        QScxmlStateMachine *stateMachine = m_stateMachine;
+        qCDebug(qscxmlLog) << parentStateMachine() << "starting" << stateMachine
+                           << "on a worker thread";
+        QMetaObject::invokeMethod(
+                    &QScxmlStateMachinePrivate::get(stateMachine)->m_eventLoopHook,
+                    [stateMachine, data]() {
+            stateMachine->setInitialValues(data);
+            if (stateMachine->init())
+                stateMachine->start();
+            else
+                qCDebug(qscxmlLog) << "failed to start" << stateMachine;
+        }, Qt::QueuedConnection);
+        return true;
+    }
+
     m_stateMachine->setInitialValues(data);
     if (m_stateMachine->init()) {
         qCDebug(qscxmlLog) << parentStateMachine() << "starting" << m_stateMachine;
@@ -388,7 +458,10 @@ QString QScxmlScxmlService::name() const
  */
 void QScxmlScxmlService::postEvent(QScxmlEvent *event)
 {
-    QScxmlStateMachinePrivate::get(m_stateMachine)->postEvent(event);
+    if (m_toChild)
+        m_toChild->send(event, parentStateMachine());
+    else
+        QScxmlStateMachinePrivate::get(m_stateMachine)->postServiceEvent(event);
 }
 
 QScxmlStateMachine *QScxmlScxmlService::stateMachine() const
@@ -396,6 +469,47 @@ QScxmlStateMachine *QScxmlScxmlService::stateMachine() const
     return m_stateMachine;
 }
 
+/*!
+  \internal
+  Moves the wrapped state machine to one of the worker threads shared by all invoked services.
+  From then on, the state machine and this service exchange events only through channels that
+  deliver them on the receiver's thread.
+ */
+void QScxmlScxmlService::moveToWorkerThread()
+{
+    auto smp = QScxmlStateMachinePrivate::get(m_stateMachine);
+    m_toChild = std::make_shared<QScxmlInternal::EventChannel>(m_stateMachine);
+    m_toParent = std::make_shared<QScxmlInternal::EventChannel>(parentStateMachine());
+    smp->m_inbox = m_toChild;
+    smp->m_parentChannel = m_toParent;
+
+    // The service owns the state machine. It cannot keep a QObject parent on another thread.
+    m_stateMachine->setParent(nullptr);
+    smp->moveToThread(invokeThreadPool()->nextThread());
+}
+
+/*!
+  \internal
+  Resets the wrapped state machine and hands this service back to its factory, so that the next
+  invocation can start it again instead of building a new state machine. Returns \c false if the
+  service was not created for reuse or the state machine cannot be reset. The caller has to
+  delete the service then.
+ */
+bool QScxmlScxmlService::recycle()
+{
+    Q_D(QScxmlInvokableService);
+    auto factory = qobject_cast<QScxmlInvokableServiceFactory *>(parent());
+    if (!m_recyclable || m_toChild || factory == nullptr
+            || !QScxmlStateMachinePrivate::get(m_stateMachine)->resetForReuse()) {
+        return false;
+    }
+
+    qCDebug(qscxmlLog) << parentStateMachine() << "recycling" << m_stateMachine;
+    d->restoredId.clear();
+    QScxmlInvokableServiceFactoryPrivate::get(factory)->recycledServices.push_back(this);
+    return true;
+}
+
 /*!
   Creates a factory for dynamically resolved services, passing the attributes of
   the \c <invoke> element as \a invokeInfo, any \c <param> child elements as
@@ -442,9 +556,17 @@ QScxmlInvokableService *QScxmlStaticScxmlServiceFactory::invoke(
         QScxmlStateMachine *parentStateMachine)
 {
     Q_D(const QScxmlStaticScxmlServiceFactory);
+    if (QScxmlScxmlService *recycled = takeRecycledScxmlService(this, parentStateMachine))
+        return recycled;
+
     QScxmlStateMachine *instance = qobject_cast<QScxmlStateMachine *>(
                 d->metaObject->newInstance(Q_ARG(QObject *, this)));
-    return instance ? invokeStaticScxmlService(instance, parentStateMachine, this) : nullptr;
+    if (!instance)
+        return nullptr;
+
+    QScxmlScxmlService *service = invokeStaticScxmlService(instance, parentStateMachine, this);
+    service->setRecyclable(true);
+    return service;
 }
 
 QScxmlInvokableServiceFactory::QScxmlInvokableServiceFactory(
@@ -457,7 +579,33 @@ QScxmlScxmlService *invokeStaticScxmlService(QScxmlStateMachine *childStateMachi
                                              QScxmlInvokableServiceFactory *factory)
 {
     QScxmlStateMachinePrivate::get(childStateMachine)->setIsInvoked(true);
-    return new QScxmlScxmlService(childStateMachine, parentStateMachine, factory);
+    auto service = new QScxmlScxmlService(childStateMachine, parentStateMachine, factory);
+    if (parentStateMachine->isThreadedInvocation()) {
+        service->moveToWorkerThread();
+    } else {
+        // Children in the same thread run on the same clock, so that their delayed events stay
+        // in order with the parent's.
+        QScxmlStateMachinePrivate::get(childStateMachine)->setClock(
+                    QScxmlStateMachinePrivate::get(parentStateMachine)->m_clock);
+    }
+    return service;
+}
+
+QScxmlScxmlService *takeRecycledScxmlService(QScxmlInvokableServiceFactory *factory,
+                                             QScxmlStateMachine *parentStateMachine)
+{
+    if (parentStateMachine->isThreadedInvocation())
+        return nullptr;
+
+    auto &recycled = QScxmlInvokableServiceFactoryPrivate::get(factory)->recycledServices;
+    for (auto it = recycled.begin(), end = recycled.end(); it != end; ++it) {
+        QScxmlScxmlService *service = *it;
+        if (service->parentStateMachine() == parentStateMachine) {
+            recycled.erase(it);
+            return service;
+        }
+    }
+    return nullptr;
 }
 
 QT_END_NAMESPACE
@@ -54,13 +54,23 @@
 #include "qscxmlinvokableservice.h"
 #include <QtCore/private/qobject_p.h>
 
+#include <memory>
+#include <vector>
+
 QT_BEGIN_NAMESPACE
 
+namespace QScxmlInternal {
+class EventChannel;
+}
+
 class QScxmlInvokableServicePrivate : public QObjectPrivate
 {
 public:
     QScxmlInvokableServicePrivate(QScxmlStateMachine *parentStateMachine);
 
+    static QScxmlInvokableServicePrivate *get(QScxmlInvokableService *service)
+    { return static_cast<QScxmlInvokableServicePrivate *>(QObjectPrivate::get(service)); }
+
     QString calculateId(QScxmlStateMachine *parent,
                         const QScxmlExecutableContent::InvokeInfo &invokeInfo, bool *ok) const;
     QVariantMap calculateData(QScxmlStateMachine *parent,
@@ -69,8 +79,10 @@ public:
                               bool *ok) const;
 
     QScxmlStateMachine *parentStateMachine;
+    QString restoredId; // the id from a snapshot, used instead of a new one
 };
 
+class QScxmlScxmlService;
 class QScxmlInvokableServiceFactoryPrivate : public QObjectPrivate
 {
 public:
@@ -79,9 +91,16 @@ public:
             const QList<QScxmlExecutableContent::StringId> &names,
             const QList<QScxmlExecutableContent::ParameterInfo> &parameters);
 
+    static QScxmlInvokableServiceFactoryPrivate *get(QScxmlInvokableServiceFactory *factory)
+    { return static_cast<QScxmlInvokableServiceFactoryPrivate *>(QObjectPrivate::get(factory)); }
+
     QScxmlExecutableContent::InvokeInfo invokeInfo;
     QList<QScxmlExecutableContent::StringId> names;
     QList<QScxmlExecutableContent::ParameterInfo> parameters;
+
+    // Cancelled SCXML services, reset and waiting for the next invocation. They are children of
+    // the factory, so they are deleted along with it.
+    std::vector<QScxmlScxmlService *> recycledServices;
 };
 
 class Q_SCXML_EXPORT QScxmlScxmlService: public QScxmlInvokableService
@@ -101,8 +120,18 @@ public:
     void postEvent(QScxmlEvent *event) override;
     QScxmlStateMachine *stateMachine() const;
 
+    void setRecyclable(bool recyclable)
+    { m_recyclable = recyclable; }
+    bool recycle();
+    void moveToWorkerThread();
+
 private:
     QScxmlStateMachine *m_stateMachine;
+    bool m_recyclable = false;
+
+    // Only set if the state machine runs on a worker thread.
+    std::shared_ptr<QScxmlInternal::EventChannel> m_toChild;
+    std::shared_ptr<QScxmlInternal::EventChannel> m_toParent;
 };
 
 class QScxmlStaticScxmlServiceFactoryPrivate : public QScxmlInvokableServiceFactoryPrivate
@@ -123,6 +152,8 @@ QScxmlScxmlService *invokeDynamicScxmlService(const QString &sourceUrl,
 QScxmlScxmlService *invokeStaticScxmlService(QScxmlStateMachine *childStateMachine,
                                              QScxmlStateMachine *parentStateMachine,
                                              QScxmlInvokableServiceFactory *factory);
+QScxmlScxmlService *takeRecycledScxmlService(QScxmlInvokableServiceFactory *factory,
+                                             QScxmlStateMachine *parentStateMachine);
 QString calculateSrcexpr(QScxmlStateMachine *parent, QScxmlExecutableContent::EvaluatorId srcexpr,
                          bool *ok);
 
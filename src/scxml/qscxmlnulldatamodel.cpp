@@ -84,7 +84,7 @@ public:
 
     ResolvedEvaluatorInfo prepare(QScxmlExecutableContent::EvaluatorId id)
     {
-        auto td = m_stateMachine->tableData();
+        auto td = QScxmlStateMachinePrivate::get(m_stateMachine.value());
         const QScxmlExecutableContent::EvaluatorInfo &info = td->evaluatorInfo(id);
         QString expr = td->string(info.expr);
         for (int i = 0; i < expr.size(); ) {
@@ -165,7 +165,7 @@ QString QScxmlNullDataModel::evaluateToString(QScxmlExecutableContent::Evaluator
     // We do implement this, because <log> is allowed in the Null data model,
     // and <log> has an expr attribute that needs "evaluation" for it to generate the log message.
     *ok = true;
-    auto td = d->m_stateMachine->tableData();
+    auto td = QScxmlStateMachinePrivate::get(d->m_stateMachine.value());
     const QScxmlExecutableContent::EvaluatorInfo &info = td->evaluatorInfo(id);
     return td->string(info.expr);
 }
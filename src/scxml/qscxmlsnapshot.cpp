@@ -0,0 +1,498 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtScxml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qscxmlstatemachine_p.h"
+#include "qscxmlevent_p.h"
+#include "qscxmlinvokableservice_p.h"
+
+#include <QtCore/qdatastream.h>
+#include <QtCore/qiodevice.h>
+
+#include <memory>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace QScxmlInternal {
+
+// A snapshot starts with a magic number and a format version. The rest is written with a fixed
+// QDataStream version, so that it can be restored by another build of the library. When the
+// format changes, SnapshotVersion has to be increased.
+enum : quint32 { SnapshotMagic = 0x53435853 }; // "SCXS"
+enum : quint16 { SnapshotVersion = 1 };
+static const QDataStream::Version SnapshotStreamVersion = QDataStream::Qt_6_0;
+
+// A snapshot as read from a stream. It is read completely and checked before it is applied, so
+// that a state machine is left alone if the snapshot is broken or does not fit it.
+struct Snapshot
+{
+    struct DelayedEvent
+    {
+        int remainingTime;
+        std::unique_ptr<QScxmlEvent> event;
+    };
+
+    struct Service
+    {
+        int id;
+        int invokingState;
+        QString serviceId;
+        std::unique_ptr<Snapshot> stateMachine; // only for SCXML services on the same thread
+    };
+
+    bool read(QDataStream &stream);
+
+    int tableVersion = 0;
+    QString name;
+    int stateCount = 0;
+    int transitionCount = 0;
+    int serviceCount = 0;
+    int runningState = 0;
+    std::vector<int> configuration;
+    std::vector<bool> isFirstStateEntry;
+    std::vector<int> historyCounts; // one per history record, -1 if nothing was recorded yet
+    std::vector<int> historyValues; // the recorded states, for all records in turn
+    std::vector<std::pair<QString, QVariant>> data;
+    std::vector<std::unique_ptr<QScxmlEvent>> internalQueue;
+    std::vector<std::unique_ptr<QScxmlEvent>> externalQueue;
+    std::vector<DelayedEvent> delayedEvents;
+    std::vector<Service> services;
+};
+
+static bool readEvents(QDataStream &stream, std::vector<std::unique_ptr<QScxmlEvent>> *events)
+{
+    qint32 count = 0;
+    stream >> count;
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        std::unique_ptr<QScxmlEvent> event(QScxmlEventPrivate::read(stream));
+        if (!event)
+            return false;
+        events->push_back(std::move(event));
+    }
+    return count >= 0 && stream.status() == QDataStream::Ok;
+}
+
+static bool readStateIndexes(QDataStream &stream, int stateCount, std::vector<int> *indexes)
+{
+    qint32 count = 0;
+    stream >> count;
+    if (count < 0 || count > stateCount)
+        return false;
+    for (qint32 i = 0; i < count; ++i) {
+        qint32 index = -1;
+        stream >> index;
+        if (index < 0 || index >= stateCount)
+            return false;
+        indexes->push_back(index);
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+bool Snapshot::read(QDataStream &stream)
+{
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if (magic != SnapshotMagic || version != SnapshotVersion)
+        return false;
+    stream.setVersion(SnapshotStreamVersion);
+
+    qint32 historyCount = 0;
+    stream >> tableVersion >> name >> stateCount >> transitionCount >> historyCount
+           >> serviceCount;
+    quint8 state = 0;
+    stream >> state;
+    runningState = state;
+    if (stream.status() != QDataStream::Ok || stateCount < 0 || historyCount < 0
+            || serviceCount < 0) {
+        return false;
+    }
+
+    if (!readStateIndexes(stream, stateCount, &configuration))
+        return false;
+
+    qint32 firstEntryCount = 0;
+    stream >> firstEntryCount;
+    if (firstEntryCount != 0 && firstEntryCount != stateCount)
+        return false;
+    for (qint32 i = 0; i < firstEntryCount; ++i) {
+        bool isFirst = false;
+        stream >> isFirst;
+        isFirstStateEntry.push_back(isFirst);
+    }
+
+    for (qint32 i = 0; i < historyCount && stream.status() == QDataStream::Ok; ++i) {
+        qint32 count = -1;
+        stream >> count;
+        if (count < -1 || count > stateCount)
+            return false;
+        historyCounts.push_back(count);
+        for (qint32 j = 0; j < count; ++j) {
+            qint32 value = -1;
+            stream >> value;
+            if (value < 0 || value >= stateCount)
+                return false;
+            historyValues.push_back(value);
+        }
+    }
+
+    qint32 dataCount = 0;
+    stream >> dataCount;
+    for (qint32 i = 0; i < dataCount && stream.status() == QDataStream::Ok; ++i) {
+        QString dataName;
+        QVariant value;
+        stream >> dataName >> value;
+        data.emplace_back(dataName, value);
+    }
+    if (dataCount < 0 || stream.status() != QDataStream::Ok)
+        return false;
+
+    if (!readEvents(stream, &internalQueue) || !readEvents(stream, &externalQueue))
+        return false;
+
+    qint32 delayedCount = 0;
+    stream >> delayedCount;
+    for (qint32 i = 0; i < delayedCount && stream.status() == QDataStream::Ok; ++i) {
+        qint32 remainingTime = 0;
+        stream >> remainingTime;
+        std::unique_ptr<QScxmlEvent> event(QScxmlEventPrivate::read(stream));
+        if (!event)
+            return false;
+        delayedEvents.push_back({ qMax(remainingTime, 0), std::move(event) });
+    }
+    if (delayedCount < 0 || stream.status() != QDataStream::Ok)
+        return false;
+
+    qint32 runningServices = 0;
+    stream >> runningServices;
+    if (runningServices < 0 || runningServices > serviceCount)
+        return false;
+    for (qint32 i = 0; i < runningServices; ++i) {
+        qint32 id = -1;
+        qint32 invokingState = -1;
+        QString serviceId;
+        bool hasStateMachine = false;
+        stream >> id >> invokingState >> serviceId >> hasStateMachine;
+        if (id < 0 || id >= serviceCount || invokingState < 0 || invokingState >= stateCount)
+            return false;
+        Service service { id, invokingState, serviceId, nullptr };
+        if (hasStateMachine) {
+            service.stateMachine.reset(new Snapshot);
+            if (!service.stateMachine->read(stream))
+                return false;
+        }
+        services.push_back(std::move(service));
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+} // namespace QScxmlInternal
+
+// The snapshot is written straight to the stream, so that the data model values are not copied.
+bool QScxmlStateMachinePrivate::writeSnapshot(QDataStream &stream) const
+{
+    Q_Q(const QScxmlStateMachine);
+
+    if (m_isProcessingEvents || !m_isInitialized.value() || !m_tableData.value())
+        return false;
+
+    stream << quint32(QScxmlInternal::SnapshotMagic) << quint16(QScxmlInternal::SnapshotVersion);
+    stream.setVersion(QScxmlInternal::SnapshotStreamVersion);
+    stream << qint32(m_stateTable->version) << q->name() << qint32(m_stateTable->stateCount)
+           << qint32(m_stateTable->transitionCount) << qint32(m_historyRecords.size())
+           << qint32(m_invokedServices.size()) << quint8(m_runningState);
+
+    stream << qint32(m_configuration.list().size());
+    for (int stateIndex : m_configuration)
+        stream << qint32(stateIndex);
+
+    stream << qint32(m_isFirstStateEntry.size());
+    for (bool isFirst : m_isFirstStateEntry)
+        stream << isFirst;
+
+    for (const HistoryRecord &record : m_historyRecords) {
+        stream << qint32(record.count);
+        for (int i = 0; i < record.count; ++i)
+            stream << qint32(m_historyStorage[size_t(record.offset + i)]);
+    }
+
+    QScxmlDataModel *dataModel = m_dataModel.value();
+    int dataNameCount = 0;
+    const QScxmlExecutableContent::StringId *dataNameIds = dataNames(&dataNameCount);
+    QStringList names;
+    for (int i = 0; i < dataNameCount; ++i) {
+        const QString name = string(dataNameIds[i]);
+        if (dataModel->hasScxmlProperty(name))
+            names.append(name);
+    }
+    stream << qint32(names.size());
+    for (const QString &name : names)
+        stream << name << dataModel->scxmlProperty(name);
+
+    for (const QList<QScxmlEvent *> &queue : { m_internalQueue.list(), m_externalQueue.list() }) {
+        stream << qint32(queue.size());
+        for (const QScxmlEvent *event : queue)
+            QScxmlEventPrivate::write(stream, event);
+    }
+
+    stream << qint32(m_delayedEvents.size());
+    for (const auto &delayedEvent : m_delayedEvents) {
+        stream << qint32(remainingDelay(delayedEvent.first));
+        QScxmlEventPrivate::write(stream, delayedEvent.second);
+    }
+
+    qint32 runningServices = 0;
+    for (const InvokedService &invokedService : m_invokedServices) {
+        if (invokedService.service)
+            ++runningServices;
+    }
+    stream << runningServices;
+    for (size_t id = 0, end = m_invokedServices.size(); id != end; ++id) {
+        const InvokedService &invokedService = m_invokedServices[id];
+        if (!invokedService.service)
+            continue;
+        // A state machine running on a worker thread cannot be looked at from here. It is
+        // invoked again from scratch when the snapshot is restored.
+        auto scxmlService = qobject_cast<QScxmlScxmlService *>(invokedService.service);
+        QScxmlStateMachine *child = scxmlService ? scxmlService->stateMachine() : nullptr;
+        const bool hasStateMachine = child && child->thread() == q->thread();
+        stream << qint32(id) << qint32(invokedService.invokingState) << invokedService.serviceId
+               << hasStateMachine;
+        if (hasStateMachine && !QScxmlStateMachinePrivate::get(child)->writeSnapshot(stream))
+            return false;
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+// A snapshot can only be restored into a state machine for the same document that has not
+// processed any events yet.
+bool QScxmlStateMachinePrivate::canRestore(const QScxmlInternal::Snapshot &snapshot) const
+{
+    Q_Q(const QScxmlStateMachine);
+
+    if (m_isProcessingEvents || !m_tableData.value() || !m_configuration.isEmpty())
+        return false;
+    if (m_runningState != Invalid && m_runningState != Starting)
+        return false;
+    if (snapshot.runningState < Starting || snapshot.runningState > Finished)
+        return false;
+
+    if (snapshot.tableVersion != m_stateTable->version || snapshot.name != q->name()
+            || snapshot.stateCount != m_stateTable->stateCount
+            || snapshot.transitionCount != m_stateTable->transitionCount
+            || snapshot.historyCounts.size() != m_historyRecords.size()
+            || snapshot.serviceCount != int(m_invokedServices.size())) {
+        return false;
+    }
+
+    for (size_t i = 0, ei = m_historyRecords.size(); i != ei; ++i) {
+        if (snapshot.historyCounts[i] > m_historyRecords[i].capacity)
+            return false;
+    }
+
+    if (!snapshot.isFirstStateEntry.empty()
+            && m_stateTable->binding != StateTable::LateBinding) {
+        return false;
+    }
+
+    return true;
+}
+
+bool QScxmlStateMachinePrivate::restoreSnapshot(QScxmlInternal::Snapshot &snapshot)
+{
+    Q_Q(QScxmlStateMachine);
+    Q_ASSERT(canRestore(snapshot));
+
+    // The data comes from the snapshot, so the initial setup of the document is not run again.
+    if (!m_isInitialized.value()) {
+        if (!setupDataModel())
+            return false;
+        m_isInitialized.setValue(true);
+    }
+
+    QScxmlDataModel *dataModel = m_dataModel.value();
+    for (const auto &entry : snapshot.data) {
+        if (dataModel->hasScxmlProperty(entry.first))
+            dataModel->setScxmlProperty(entry.first, entry.second, QString());
+    }
+
+    auto historyValue = snapshot.historyValues.cbegin();
+    for (size_t i = 0, ei = m_historyRecords.size(); i != ei; ++i) {
+        HistoryRecord &record = m_historyRecords[i];
+        record.count = snapshot.historyCounts[i];
+        for (int j = 0; j < record.count; ++j)
+            m_historyStorage[size_t(record.offset + j)] = *historyValue++;
+    }
+
+    if (!snapshot.isFirstStateEntry.empty())
+        m_isFirstStateEntry = snapshot.isFirstStateEntry;
+
+    for (auto &event : snapshot.internalQueue)
+        m_internalQueue.enqueue(event.release());
+    for (auto &event : snapshot.externalQueue)
+        enqueueExternalEvent(event.release());
+
+    for (auto &delayedEvent : snapshot.delayedEvents) {
+        const int timerId = startDelayTimer(delayedEvent.remainingTime);
+        if (timerId == 0) {
+            qCWarning(qscxmlLog) << q << "failed to restart the timer for delayed event"
+                                 << delayedEvent.event->name();
+            continue;
+        }
+        m_delayedEvents.push_back(std::make_pair(timerId, delayedEvent.event.release()));
+    }
+    delayedEventsChanged();
+
+    const bool wasRunning = isRunnable() && !isPaused();
+    m_runningState = decltype(m_runningState)(snapshot.runningState);
+    for (int stateIndex : snapshot.configuration) {
+        if (m_configuration.add(stateIndex))
+            m_activeEventlessStates += m_hasEventlessTransitions[size_t(stateIndex)];
+    }
+
+    for (auto &savedService : snapshot.services) {
+        const int id = savedService.id;
+        auto service = serviceFactory(id)->invoke(q);
+        if (service == nullptr)
+            continue; // service failed to start
+        m_invokedServices[size_t(id)] = { savedService.invokingState, service, service->name(),
+                                          QString() };
+
+        // The service keeps its id, so that events sent to it, and the done.invoke.<id> events it
+        // sent before the snapshot, are still routed.
+        QScxmlInvokableServicePrivate::get(service)->restoredId = savedService.serviceId;
+
+        // A child with a saved state continues from there instead of being started, so that it
+        // doesn't run its initial setup again.
+        auto scxmlService = qobject_cast<QScxmlScxmlService *>(service);
+        QScxmlStateMachine *child = scxmlService ? scxmlService->stateMachine() : nullptr;
+        auto childPrivate = savedService.stateMachine && child && child->thread() == q->thread()
+                ? QScxmlStateMachinePrivate::get(child) : nullptr;
+        if (childPrivate && childPrivate->canRestore(*savedService.stateMachine)) {
+            childPrivate->m_sessionId = savedService.serviceId;
+            if (childPrivate->restoreSnapshot(*savedService.stateMachine)) {
+                indexService(id);
+                continue;
+            }
+        }
+
+        if (savedService.stateMachine) {
+            qCWarning(qscxmlLog) << q << "could not restore the state of service"
+                                 << savedService.serviceId << "- it was started from scratch";
+        }
+        service->start();
+        indexService(id);
+    }
+    if (!snapshot.services.empty())
+        emitInvokedServicesChanged();
+
+    for (int stateIndex : m_configuration)
+        emitStateActive(stateIndex, true);
+    const bool running = isRunnable() && !isPaused();
+    if (running != wasRunning)
+        emit q->runningChanged(running);
+    if (isRunnable())
+        m_eventLoopHook.queueProcessEvents();
+    return true;
+}
+
+/*!
+  \since 6.4
+
+  Writes a snapshot of the state machine's session to \a device. This covers
+  the active states, the recorded history, the events waiting in the queues,
+  the delayed events together with the time left until they are due, the
+  services that are running, and the values of the data items declared in the
+  document. The state of SCXML services running on the same thread is included
+  as well.
+
+  The snapshot is written in a compact, versioned binary format. It can be
+  read back with restoreSnapshot(), also by another process or on another
+  machine.
+
+  Snapshots cannot be taken while the state machine is processing events, or
+  before it has been initialized. The values of a C++ data model are kept in
+  members of the generated class and are not part of the snapshot.
+
+  Returns \c true if the snapshot was written completely.
+
+  \sa restoreSnapshot()
+ */
+bool QScxmlStateMachine::saveSnapshot(QIODevice *device) const
+{
+    Q_D(const QScxmlStateMachine);
+    QDataStream stream(device);
+    return d->writeSnapshot(stream);
+}
+
+/*!
+  \since 6.4
+
+  Restores the session saved by saveSnapshot() from \a device. The state
+  machine has to be created from the same document as the one the snapshot was
+  taken of, and it must not have processed any events yet. It is initialized
+  if necessary, and then continues where the saved state machine was, without
+  running any executable content for the saved states again. This includes the
+  \c <data> initializers and the \c <script> of the \c <scxml> element.
+  Delayed events are due after the time that was left when the snapshot was
+  taken.
+
+  Services that were running are invoked again with the ids they had. SCXML
+  services that ran on the same thread continue from the state in the
+  snapshot. Other services start from scratch.
+
+  Returns \c true if the snapshot was restored. If the snapshot cannot be read,
+  or does not fit the state machine, \c false is returned and the state
+  machine is left unchanged.
+
+  \sa saveSnapshot()
+ */
+bool QScxmlStateMachine::restoreSnapshot(QIODevice *device)
+{
+    Q_D(QScxmlStateMachine);
+    QDataStream stream(device);
+    QScxmlInternal::Snapshot snapshot;
+    if (!snapshot.read(stream) || !d->canRestore(snapshot))
+        return false;
+    return d->restoreSnapshot(snapshot);
+}
+
+QT_END_NAMESPACE
@@ -40,8 +40,13 @@
 #include "qscxmlstatemachine_p.h"
 #include "qscxmlexecutablecontent_p.h"
 #include "qscxmlevent_p.h"
-#include "qscxmlinvokableservice.h"
+#include "qscxmlinvokableservice_p.h"
 #include "qscxmldatamodel_p.h"
+#include "qscxmlcppdatamodel_p.h"
+#include <qabstracteventdispatcher.h>
+#include <qcoreapplication.h>
+#include <qdeadlinetimer.h>
+#include <qelapsedtimer.h>
 
 #include <qfile.h>
 #include <qhash.h>
@@ -49,8 +54,10 @@
 #include <qstring.h>
 #include <qtimer.h>
 #include <qthread.h>
+#include <qvarlengtharray.h>
 
 #include <functional>
+#include <limits>
 
 QT_BEGIN_NAMESPACE
 
@@ -323,16 +330,129 @@ void EventLoopHook::doProcessEvents()
 
 void EventLoopHook::timerEvent(QTimerEvent *timerEvent)
 {
-    const int timerId = timerEvent->timerId();
-    for (auto it = smp->m_delayedEvents.begin(), eit = smp->m_delayedEvents.end(); it != eit; ++it) {
-        if (it->first == timerId) {
-            QScxmlEvent *scxmlEvent = it->second;
-            smp->m_delayedEvents.erase(it);
-            smp->routeEvent(scxmlEvent);
-            killTimer(timerId);
-            return;
+    smp->delayTimerFired(timerEvent->timerId());
+}
+
+EventChannel::EventChannel(QScxmlStateMachine *receiver)
+    : m_receiver(receiver)
+{}
+
+EventChannel::~EventChannel()
+{
+    qDeleteAll(m_pending);
+}
+
+// Returns false if the event was rejected, because the receiver's queue had no room for it in
+// time. The sender gets an error.communication event then. sender has to live on the current
+// thread.
+bool EventChannel::send(QScxmlEvent *event, QScxmlStateMachine *sender)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // A sender on the receiver's own thread would wait forever, so it never blocks. Neither does a
+    // sender that some other thread waits for, as the two might be waiting for each other. The
+    // channel holds its events beyond the receiver's capacity instead. Two senders that start
+    // waiting for each other at the same time don't see each other, so no wait is unbounded.
+    auto senderPrivate = QScxmlStateMachinePrivate::get(sender);
+    QDeadlineTimer deadline(MaxSendWait);
+    while (m_receiver != nullptr && m_receiver->thread() != QThread::currentThread()
+           && senderPrivate->m_waitingSenders.loadRelaxed() == 0) {
+        auto smp = QScxmlStateMachinePrivate::get(m_receiver);
+        const int limit = smp->m_externalQueueLimit.loadRelaxed();
+        if (limit == 0 || !smp->m_blockSenders.loadRelaxed() || m_pending.size() < limit)
+            break;
+
+        ++m_waitingSenders;
+        smp->m_waitingSenders.ref();
+        m_space.wait(&m_mutex, deadline);
+        --m_waitingSenders;
+        if (m_receiver == nullptr)
+            break; // close() has taken back what the waiting senders counted
+        smp->m_waitingSenders.deref();
+
+        if (deadline.hasExpired() && m_pending.size() >= limit) {
+            QScxmlInternal::Metrics::add(smp->m_metrics.externalEventsRejected);
+            qCWarning(qscxmlLog) << sender << "gave up waiting for room in the queue of"
+                                 << m_receiver << "- event" << event->name() << "was rejected";
+            locker.unlock();
+            senderPrivate->submitError(
+                        QStringLiteral("error.communication"),
+                        QStringLiteral("The external event queue of the receiver stayed full, "
+                                       "event '%1' was rejected.").arg(event->name()),
+                        event->sendId());
+            delete event;
+            return false;
         }
     }
+
+    if (m_receiver == nullptr) {
+        delete event;
+        return true;
+    }
+
+    // One queued call delivers everything sent until it runs. The receiver closes the channel
+    // before it is destroyed, so it is still alive while we hold the lock.
+    m_pending.append(event);
+    if (m_pending.size() == 1) {
+        auto self = shared_from_this();
+        QMetaObject::invokeMethod(&QScxmlStateMachinePrivate::get(m_receiver)->m_eventLoopHook,
+                                  [self]() { self->deliver(); }, Qt::QueuedConnection);
+    }
+    return true;
+}
+
+void EventChannel::close()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_receiver != nullptr && m_waitingSenders > 0) {
+        QScxmlStateMachinePrivate::get(m_receiver)->m_waitingSenders.fetchAndSubRelaxed(
+                    m_waitingSenders);
+    }
+    m_receiver = nullptr;
+    qDeleteAll(m_pending);
+    m_pending.clear();
+    m_space.wakeAll();
+}
+
+void EventChannel::resume()
+{
+    m_stalled = false;
+    deliver();
+}
+
+// Runs on the receiver's thread, which is also the only thread that closes the channel after the
+// receiver is set.
+void EventChannel::deliver()
+{
+    QMutexLocker locker(&m_mutex);
+    QScxmlStateMachine *receiver = m_receiver;
+    QList<QScxmlEvent *> events;
+    events.swap(m_pending);
+    if (receiver != nullptr) {
+        // Hold back what does not fit into a queue that blocks senders.
+        auto smp = QScxmlStateMachinePrivate::get(receiver);
+        const int limit = smp->m_externalQueueLimit.loadRelaxed();
+        const qsizetype room = qMax(limit - smp->m_externalQueue.size(), 0);
+        if (limit > 0 && smp->m_blockSenders.loadRelaxed() && room < events.size()) {
+            m_pending = events.sliced(room);
+            events.resize(room);
+            if (!m_stalled) {
+                m_stalled = true;
+                smp->m_stalledChannels.push_back(shared_from_this());
+            }
+        }
+    }
+    m_space.wakeAll();
+    locker.unlock();
+
+    if (receiver == nullptr) {
+        qDeleteAll(events);
+        return;
+    }
+
+    auto smp = QScxmlStateMachinePrivate::get(receiver);
+    for (QScxmlEvent *event : std::as_const(events))
+        smp->postServiceEvent(event);
 }
 
 void ScxmlEventRouter::route(const QStringList &segments, QScxmlEvent *event)
@@ -421,6 +541,56 @@ QMetaObject::Connection ScxmlEventRouter::connectToEvent(const QStringList &segm
     }
 }
 
+void Metrics::resize(int newStateCount)
+{
+    QMutexLocker locker(&stateMutex);
+    executableContentTime.reset(newStateCount > 0 ? new Counter[newStateCount] : nullptr);
+    stateCount = newStateCount;
+}
+
+void Metrics::reset()
+{
+    internalEvents.storeRelaxed(0);
+    externalEvents.storeRelaxed(0);
+    macrosteps.storeRelaxed(0);
+    microsteps.storeRelaxed(0);
+    for (Counter &counter : microstepsPerMacrostep)
+        counter.storeRelaxed(0);
+    guardEvaluations.storeRelaxed(0);
+    guardRejections.storeRelaxed(0);
+    guardErrors.storeRelaxed(0);
+    externalEventsRejected.storeRelaxed(0);
+    externalEventsDropped.storeRelaxed(0);
+    internalQueueHighWater.storeRelaxed(0);
+    externalQueueHighWater.storeRelaxed(0);
+    QMutexLocker locker(&stateMutex);
+    for (int i = 0; i < stateCount; ++i)
+        executableContentTime[i].storeRelaxed(0);
+}
+
+void Profile::enable(int stateCount, int transitionCount, const std::vector<int> &configuration)
+{
+    states.assign(size_t(stateCount), StateCounters());
+    transitions.assign(size_t(transitionCount), TransitionCounters());
+    clock.start();
+    enabled = true;
+    for (int stateIndex : configuration)
+        states[size_t(stateIndex)].enteredAt = 0;
+}
+
+void Profile::disable()
+{
+    enabled = false;
+    states = std::vector<StateCounters>();
+    transitions = std::vector<TransitionCounters>();
+}
+
+void Profile::reset(const std::vector<int> &configuration)
+{
+    if (enabled)
+        enable(int(states.size()), int(transitions.size()), configuration);
+}
+
 } // namespace QScxmlInternal
 
 QAtomicInt QScxmlStateMachinePrivate::m_sessionIdCounter = QAtomicInt(0);
@@ -443,6 +613,13 @@ QScxmlStateMachinePrivate::QScxmlStateMachinePrivate(const QMetaObject *metaObje
 
 QScxmlStateMachinePrivate::~QScxmlStateMachinePrivate()
 {
+    // Timers of the event loop die with m_eventLoopHook, but those of a clock don't.
+    if (m_clock) {
+        for (const auto &delayedEvent : m_delayedEvents)
+            killDelayTimer(delayedEvent.first);
+    }
+    if (m_inbox)
+        m_inbox->close();
     for (const InvokedService &invokedService : m_invokedServices)
         delete invokedService.service;
     qDeleteAll(m_cachedFactories);
@@ -471,12 +648,35 @@ void QScxmlStateMachinePrivate::addService(int invokingState)
         if (service == nullptr)
             continue; // service failed to start
         const QString serviceName = service->name();
-        m_invokedServices[size_t(id)] = { invokingState, service, serviceName };
+        m_invokedServices[size_t(id)] = { invokingState, service, serviceName, QString() };
         service->start();
+        indexService(id);
     }
     emitInvokedServicesChanged();
 }
 
+// The id of a service is only known once it has been started.
+void QScxmlStateMachinePrivate::indexService(int id)
+{
+    InvokedService &invokedService = m_invokedServices[size_t(id)];
+    invokedService.serviceId = invokedService.service->id();
+    m_invokedServiceIds.insert(invokedService.serviceId, id);
+    if (serviceFactory(id)->invokeInfo().autoforward) {
+        m_autoforwardServices.insert(std::lower_bound(m_autoforwardServices.begin(),
+                                                      m_autoforwardServices.end(), id), id);
+    }
+}
+
+void QScxmlStateMachinePrivate::unindexService(int id)
+{
+    InvokedService &invokedService = m_invokedServices[size_t(id)];
+    m_invokedServiceIds.remove(invokedService.serviceId, id);
+    invokedService.serviceId.clear();
+    auto it = std::lower_bound(m_autoforwardServices.begin(), m_autoforwardServices.end(), id);
+    if (it != m_autoforwardServices.end() && *it == id)
+        m_autoforwardServices.erase(it);
+}
+
 void QScxmlStateMachinePrivate::removeService(int invokingState)
 {
     const int arrayId = m_stateTable->state(invokingState).serviceFactoryIds;
@@ -487,13 +687,22 @@ void QScxmlStateMachinePrivate::removeService(int invokingState)
         auto &it = m_invokedServices[i];
         QScxmlInvokableService *service = it.service;
         if (it.invokingState == invokingState && service != nullptr) {
+            unindexService(int(i));
             it.service = nullptr;
-            delete service;
+            releaseService(service);
         }
     }
     emitInvokedServicesChanged();
 }
 
+void QScxmlStateMachinePrivate::releaseService(QScxmlInvokableService *service)
+{
+    // SCXML children go back to their factory to be started again by the next invocation.
+    auto scxmlService = qobject_cast<QScxmlScxmlService *>(service);
+    if (scxmlService == nullptr || !scxmlService->recycle())
+        delete service;
+}
+
 QScxmlInvokableServiceFactory *QScxmlStateMachinePrivate::serviceFactory(int id)
 {
     Q_ASSERT(id <= m_stateTable->maxServiceId && id >= 0);
@@ -503,92 +712,456 @@ QScxmlInvokableServiceFactory *QScxmlStateMachinePrivate::serviceFactory(int id)
     return factory;
 }
 
+bool QScxmlStateMachinePrivate::setupDataModel()
+{
+    Q_Q(QScxmlStateMachine);
+
+    if (!q->parseErrors().isEmpty())
+        return false;
+
+    QScxmlDataModel *dataModel = m_dataModel.value();
+    if (!dataModel || !dataModel->setup(m_initialValues.value()))
+        return false;
+
+    if (auto cppDataModel = qobject_cast<QScxmlCppDataModel *>(dataModel)) {
+        m_cppDataModel = cppDataModel;
+        m_cppEvaluators = QScxmlCppDataModelPrivate::evaluatorTable(cppDataModel);
+    }
+    return true;
+}
+
 bool QScxmlStateMachinePrivate::executeInitialSetup()
 {
     return m_executionEngine->execute(m_tableData.value()->initialSetup());
 }
 
-void QScxmlStateMachinePrivate::routeEvent(QScxmlEvent *event)
+bool QScxmlStateMachinePrivate::evaluateCondition(QScxmlExecutableContent::EvaluatorId id,
+                                                  bool *ok)
+{
+    *ok = true;
+    if (m_cppEvaluators && id >= 0 && id < m_cppEvaluators->boolEvaluatorCount) {
+        if (const auto evaluator = m_cppEvaluators->boolEvaluators[id])
+            return (m_cppDataModel->*evaluator)();
+    }
+
+    *ok = false;
+    return m_dataModel.value()->evaluateToBool(id, ok) && *ok;
+}
+
+bool QScxmlStateMachinePrivate::evaluateGuard(int transitionIndex,
+                                              QScxmlExecutableContent::EvaluatorId condition)
+{
+    bool ok = false;
+    bool result = false;
+    if (Q_LIKELY(!QScxmlInternal::Trace::isEnabled())) {
+        result = evaluateCondition(condition, &ok);
+    } else {
+        const quint64 start = QScxmlInternal::Trace::timestamp();
+        result = evaluateCondition(condition, &ok);
+        const quint64 duration = qMin(QScxmlInternal::Trace::timestamp() - start,
+                                      quint64(std::numeric_limits<qint32>::max()));
+        QScxmlInternal::Trace::record(traceId(), QScxmlInternal::TraceRecord::GuardEvaluated,
+                                      transitionIndex, qint32(duration), result ? 1 : 0);
+    }
+
+    QScxmlInternal::Metrics::add(m_metrics.guardEvaluations);
+    if (!result)
+        m_profile.guardRejected(transitionIndex);
+    if (!ok)
+        QScxmlInternal::Metrics::add(m_metrics.guardErrors);
+    else if (!result)
+        QScxmlInternal::Metrics::add(m_metrics.guardRejections);
+    return result;
+}
+
+bool QScxmlStateMachinePrivate::executeTimed(int stateIndex,
+                                             QScxmlExecutableContent::ContainerId id,
+                                             const QVariant &extraData)
+{
+    QElapsedTimer timer;
+    timer.start();
+    const bool result = m_executionEngine->execute(id, extraData);
+    if (stateIndex >= 0 && stateIndex < m_metrics.stateCount) {
+        QScxmlInternal::Metrics::add(m_metrics.executableContentTime[stateIndex],
+                                     quint64(timer.nsecsElapsed()));
+    }
+    return result;
+}
+
+quint32 QScxmlStateMachinePrivate::traceId()
+{
+    Q_Q(QScxmlStateMachine);
+    if (m_traceId != 0)
+        return m_traceId;
+
+    QStringList states;
+    for (int i = 0; i < m_stateTable->stateCount; ++i)
+        states.append(string(m_stateTable->state(i).name));
+    QStringList transitions;
+    for (int i = 0; i < m_stateTable->transitionCount; ++i) {
+        const auto &transition = m_stateTable->transition(i);
+        QString from = QStringLiteral("(none)");
+        if (transition.source != StateTable::InvalidIndex)
+            from = states.at(transition.source);
+        QStringList to;
+        if (transition.targets != StateTable::InvalidIndex) {
+            for (int t : m_stateTable->array(transition.targets))
+                to.append(states.at(t));
+        }
+        transitions.append(from + QLatin1String(" -> ") + to.join(QLatin1Char(',')));
+    }
+    m_traceId = QScxmlInternal::Trace::registerMachine(q->name(), m_sessionId, states,
+                                                        transitions);
+    return m_traceId;
+}
+
+// Puts a state machine that was cancelled as an invoked service back into the state it had before
+// init(), without running any executable content. The tables, the meta object caches, the service
+// factories and the data model object are kept; init() sets up the data model again. Returns
+// false if the machine cannot be reused.
+bool QScxmlStateMachinePrivate::resetForReuse()
+{
+    Q_Q(QScxmlStateMachine);
+
+    // A C++ data model keeps its values in members of the generated class, and setup() does not
+    // reset those.
+    if (m_isProcessingEvents || qobject_cast<QScxmlCppDataModel *>(q->dataModel()))
+        return false;
+
+    for (auto it : m_delayedEvents) {
+        killDelayTimer(it.first);
+        delete it.second;
+    }
+    m_delayedEvents.clear();
+    delayedEventsChanged();
+    QCoreApplication::removePostedEvents(&m_eventLoopHook, QEvent::MetaCall);
+    m_internalQueue.clear();
+    m_externalQueue.clear();
+    m_externalQueueCongested.setValue(false);
+
+    m_invokedServiceIds.clear();
+    m_autoforwardServices.clear();
+    bool hadServices = false;
+    for (auto &it : m_invokedServices) {
+        if (QScxmlInvokableService *service = it.service) {
+            it.service = nullptr;
+            it.serviceId.clear();
+            releaseService(service);
+            hadServices = true;
+        }
+    }
+    if (hadServices)
+        emitInvokedServicesChanged();
+
+    const std::vector<int> configuration = m_configuration.list();
+    m_configuration.clear();
+    m_activeEventlessStates = 0;
+    for (int stateIndex : configuration)
+        emitStateActive(stateIndex, false);
+    m_statesToInvoke.clear();
+    for (HistoryRecord &record : m_historyRecords)
+        record.count = -1;
+    std::fill(m_isFirstStateEntry.begin(), m_isFirstStateEntry.end(), true);
+
+    const bool wasRunning = isRunnable() && !isPaused();
+    m_runningState = Invalid;
+    if (wasRunning)
+        emit q->runningChanged(false);
+    m_isInitialized.setValue(false);
+    return true;
+}
+
+// Moves the machine to \a thread, together with the objects that deliver its events and run its
+// timers. A data model without a QObject parent, as created by qscxmlc, is moved as well.
+void QScxmlStateMachinePrivate::moveToThread(QThread *thread)
+{
+    Q_Q(QScxmlStateMachine);
+    QScxmlDataModel *dataModel = m_dataModel.value();
+    if (dataModel && dataModel->parent() == nullptr)
+        dataModel->moveToThread(thread);
+    m_eventLoopHook.moveToThread(thread);
+    q->moveToThread(thread);
+}
+
+void QScxmlStateMachinePrivate::sendToParent(QScxmlEvent *event)
+{
+    if (m_parentChannel)
+        m_parentChannel->send(event, q_func());
+    else
+        QScxmlStateMachinePrivate::get(m_parentStateMachine)->postServiceEvent(event);
+}
+
+QScxmlStateMachine::SubmitResult QScxmlStateMachinePrivate::submitEvent(QScxmlEvent *event)
 {
     Q_Q(QScxmlStateMachine);
 
     if (!event)
-        return;
+        return QScxmlStateMachine::EventRejected;
+
+    if (event->delay() > 0) {
+        qCDebug(qscxmlLog) << q << "submitting event" << event->name()
+                           << "with delay" << event->delay() << "ms:"
+                           << QScxmlEventPrivate::debugString(event).constData();
+
+        Q_ASSERT(event->eventType() == QScxmlEvent::ExternalEvent);
+        submitDelayedEvent(event);
+        return QScxmlStateMachine::EventAccepted;
+    }
+
+    qCDebug(qscxmlLog) << q << "submitting event" << event->name()
+                       << ":" << QScxmlEventPrivate::debugString(event).constData();
+    return routeEvent(event);
+}
+
+// Returns a string that shares the characters of view, to look up hash keys without allocating.
+// It must not outlive the string the view refers to.
+static QString lookupKey(QStringView view)
+{
+    return QString::fromRawData(view.data(), view.size());
+}
+
+QScxmlStateMachine::SubmitResult QScxmlStateMachinePrivate::routeEvent(QScxmlEvent *event)
+{
+    Q_Q(QScxmlStateMachine);
+
+    if (!event)
+        return QScxmlStateMachine::EventRejected;
 
     QString origin = event->origin();
     if (origin == QStringLiteral("#_parent")) {
-        if (auto psm = m_parentStateMachine) {
-            qCDebug(qscxmlLog) << q << "routing event" << event->name() << "from" << q->name() << "to parent" << psm->name();
-                                 QScxmlStateMachinePrivate::get(psm)->postEvent(event);
+        if (m_parentStateMachine) {
+            // The parent may live on another thread, see QScxmlStateMachine::threadedInvocation.
+            qCDebug(qscxmlLog) << q << "routing event" << event->name() << "from" << q->name() << "to parent";
+            sendToParent(event);
         } else {
             qCDebug(qscxmlLog) << this << "is not invoked, so it cannot route a message to #_parent";
             delete event;
         }
     } else if (origin.startsWith(QStringLiteral("#_")) && origin != QStringLiteral("#_internal")) {
         // route to children
-        auto originId = QStringView{origin}.mid(2);
-        for (const auto &invokedService : m_invokedServices) {
-            auto service = invokedService.service;
-            if (service == nullptr)
-                continue;
-            if (service->id() == originId) {
-                qCDebug(qscxmlLog) << q << "routing event" << event->name()
-                                   << "from" << q->name()
-                                   << "to child" << service->id();
-                service->postEvent(new QScxmlEvent(*event));
-            }
+        const auto range = std::as_const(m_invokedServiceIds).equal_range(
+                    lookupKey(QStringView(origin).mid(2)));
+        for (auto it = range.first; it != range.second; ++it) {
+            auto service = m_invokedServices[size_t(*it)].service;
+            qCDebug(qscxmlLog) << q << "routing event" << event->name()
+                               << "from" << q->name()
+                               << "to child" << service->id();
+            service->postEvent(new QScxmlEvent(*event));
         }
         delete event;
     } else {
-        postEvent(event);
+        return postEvent(event);
+    }
+    return QScxmlStateMachine::EventAccepted;
+}
+
+// Events from invoked services and from the parent state machine are inputs for an event log, as
+// opposed to the events the state machine submits to itself.
+void QScxmlStateMachinePrivate::postServiceEvent(QScxmlEvent *event)
+{
+    if (Q_UNLIKELY(m_replaying)) {
+        qCDebug(qscxmlLog) << q_func() << "ignoring event" << event->name()
+                           << "while replaying an event log";
+        delete event;
+        return;
     }
+    if (Q_UNLIKELY(m_eventLog))
+        m_eventLog->writeEvent(QScxmlInternal::EventLog::ServiceEvent, event);
+    postEvent(event);
 }
 
-void QScxmlStateMachinePrivate::postEvent(QScxmlEvent *event)
+QScxmlStateMachine::SubmitResult QScxmlStateMachinePrivate::postEvent(QScxmlEvent *event)
 {
     Q_Q(QScxmlStateMachine);
 
+    QScxmlStateMachine::SubmitResult result = QScxmlStateMachine::EventAccepted;
+    const bool external = event->eventType() == QScxmlEvent::ExternalEvent;
+    const EventRule *rule = external && Q_UNLIKELY(!m_eventRules.isEmpty())
+            ? eventRule(event->name()) : nullptr;
+    const QString key = rule ? coalescingKey(event, rule) : QString();
+    const auto priority = rule ? rule->priority : QScxmlStateMachine::NormalPriority;
+
+    // A full queue is handled before the event is seen by anyone, so that a rejected event is not
+    // forwarded or reported by eventOccurred(). An event that is coalesced into a pending one
+    // does not need room.
+    const int limit = m_externalQueueLimit.loadRelaxed();
+    if (Q_UNLIKELY(external && limit > 0 && m_externalQueue.size() >= limit)
+            && !m_externalQueue.hasPending(key)) {
+        result = overflowExternalQueue(event);
+        if (result == QScxmlStateMachine::EventRejected)
+            return result;
+    }
+
     if (!event->name().startsWith(QStringLiteral("done.invoke."))) {
-        for (int id = 0, end = static_cast<int>(m_invokedServices.size()); id != end; ++id) {
-            auto service = m_invokedServices[id].service;
-            if (service == nullptr)
-                continue;
-            auto factory = serviceFactory(id);
-            if (event->invokeId() == service->id()) {
-                setEvent(event);
-
-                const QScxmlExecutableContent::ContainerId finalize
-                        = factory->invokeInfo().finalize;
-                if (finalize != QScxmlExecutableContent::NoContainer) {
-                    auto psm = service->parentStateMachine();
-                    qCDebug(qscxmlLog) << psm << "running finalize on event";
-                    auto smp = QScxmlStateMachinePrivate::get(psm);
-                    smp->m_executionEngine->execute(finalize);
-                }
+        const auto &serviceIds = m_invokedServiceIds;
+        const QString invokeId = event->invokeId();
+        const auto range = invokeId.isEmpty()
+                ? std::make_pair(serviceIds.end(), serviceIds.end())
+                : serviceIds.equal_range(invokeId);
+        for (auto it = range.first; it != range.second; ++it) {
+            auto service = m_invokedServices[size_t(*it)].service;
+            setEvent(event);
 
-                resetEvent();
-            }
-            if (factory->invokeInfo().autoforward) {
-                qCDebug(qscxmlLog) << q << "auto-forwarding event" << event->name()
-                                   << "from" << q->name()
-                                   << "to child" << service->id();
-                service->postEvent(new QScxmlEvent(*event));
+            // <finalize> may not contain <send> or <raise>, so running it ahead of the
+            // forwarding below is not observable.
+            const QScxmlExecutableContent::ContainerId finalize
+                    = serviceFactory(*it)->invokeInfo().finalize;
+            if (finalize != QScxmlExecutableContent::NoContainer) {
+                auto psm = service->parentStateMachine();
+                qCDebug(qscxmlLog) << psm << "running finalize on event";
+                auto smp = QScxmlStateMachinePrivate::get(psm);
+                smp->m_executionEngine->execute(finalize);
             }
+
+            resetEvent();
+        }
+
+        for (int id : m_autoforwardServices) {
+            auto service = m_invokedServices[size_t(id)].service;
+            qCDebug(qscxmlLog) << q << "auto-forwarding event" << event->name()
+                               << "from" << q->name()
+                               << "to child" << service->id();
+            service->postEvent(new QScxmlEvent(*event));
         }
     }
 
-    if (event->eventType() == QScxmlEvent::ExternalEvent)
+    if (external)
         m_router.route(event->name().split(QLatin1Char('.')), event);
 
-    if (event->eventType() == QScxmlEvent::ExternalEvent) {
+    if (external) {
         qCDebug(qscxmlLog) << q << "posting external event" << event->name();
-        m_externalQueue.enqueue(event);
+        if (!m_externalQueue.enqueue(event, priority, key)) {
+            qCDebug(qscxmlLog) << q << "coalesced the event with a pending one";
+            return QScxmlStateMachine::EventCoalesced;
+        }
+        QScxmlInternal::Metrics::raise(m_metrics.externalQueueHighWater, m_externalQueue.size());
+        if (Q_UNLIKELY(limit > 0 && m_externalQueue.size() >= limit))
+            m_externalQueueCongested.setValue(true);
     } else {
         qCDebug(qscxmlLog) << q << "posting internal event" << event->name();
         m_internalQueue.enqueue(event);
+        QScxmlInternal::Metrics::raise(m_metrics.internalQueueHighWater, m_internalQueue.size());
     }
 
     m_eventLoopHook.queueProcessEvents();
+    return result;
+}
+
+// Makes room for event in the full external queue, or rejects it, according to the overflow
+// policy. Senders that can be blocked are held back by their channels before the queue is full, so
+// the ones that get here cannot wait for room, and BlockSender rejects their events.
+QScxmlStateMachine::SubmitResult QScxmlStateMachinePrivate::overflowExternalQueue(
+        QScxmlEvent *event)
+{
+    Q_Q(QScxmlStateMachine);
+
+    if (m_queueOverflowPolicy.value() == QScxmlStateMachine::DropOldestEvent) {
+        QScxmlEvent *oldest = m_externalQueue.dequeueOldest();
+        qCDebug(qscxmlLog) << q << "external queue is full, dropping event" << oldest->name();
+        QScxmlInternal::Metrics::add(m_metrics.externalEventsDropped);
+        delete oldest;
+        return QScxmlStateMachine::OldestEventDropped;
+    }
+
+    qCDebug(qscxmlLog) << q << "external queue is full, rejecting event" << event->name();
+    QScxmlInternal::Metrics::add(m_metrics.externalEventsRejected);
+    submitError(QStringLiteral("error.communication"),
+                QStringLiteral("The external event queue is full, event '%1' was rejected.")
+                        .arg(event->name()),
+                event->sendId());
+    delete event;
+    return QScxmlStateMachine::EventRejected;
+}
+
+// Queues an event that is known to fit, as when restoring a snapshot. Returns false if it was
+// coalesced into a pending event.
+bool QScxmlStateMachinePrivate::enqueueExternalEvent(QScxmlEvent *event)
+{
+    const EventRule *rule = m_eventRules.isEmpty() ? nullptr : eventRule(event->name());
+    return m_externalQueue.enqueue(event,
+                                   rule ? rule->priority : QScxmlStateMachine::NormalPriority,
+                                   rule ? coalescingKey(event, rule) : QString());
+}
+
+// Rules are set for event descriptors, so the rule for "a.b.c" is the one for "a.b.c", "a.b" or
+// "a", whichever is found first.
+const QScxmlStateMachinePrivate::EventRule *QScxmlStateMachinePrivate::eventRule(
+        const QString &eventName) const
+{
+    // Like nameMatch(), a descriptor matches the whole name, or a part of it that is followed by
+    // a '.' or a '('. The longest one wins, and "*" comes last.
+    auto it = m_eventRules.constFind(eventName);
+    for (qsizetype i = eventName.size() - 1; it == m_eventRules.constEnd() && i >= 0; --i) {
+        const QChar c = eventName.at(i);
+        if (c == QLatin1Char('.') || c == QLatin1Char('('))
+            it = m_eventRules.constFind(lookupKey(QStringView(eventName).left(i)));
+    }
+    if (it == m_eventRules.constEnd())
+        it = m_eventRules.constFind(QStringLiteral("*"));
+    return it == m_eventRules.constEnd() ? nullptr : &it.value();
+}
+
+// Events with the same key replace each other while pending. The key consists of the event name
+// and, if the rule has a key field, the value of that field in the event data.
+QString QScxmlStateMachinePrivate::coalescingKey(const QScxmlEvent *event,
+                                                 const EventRule *rule) const
+{
+    if (!rule->coalesce)
+        return QString();
+    if (rule->keyField.isEmpty())
+        return event->name();
+    return event->name() + QChar::Null
+            + event->data().toMap().value(rule->keyField).toString();
+}
+
+// "a.b.*" matches the same events as "a.b".
+QString QScxmlStateMachinePrivate::eventRuleKey(const QString &eventDescriptor)
+{
+    if (eventDescriptor.endsWith(QLatin1String(".*")))
+        return eventDescriptor.chopped(2);
+    return eventDescriptor;
+}
+
+void QScxmlStateMachinePrivate::setEventRule(const QString &key, const EventRule &rule)
+{
+    if (rule.priority == QScxmlStateMachine::NormalPriority && !rule.coalesce)
+        m_eventRules.remove(key);
+    else
+        m_eventRules.insert(key, rule);
+}
+
+// Called after an event was taken from the external queue of a bounded state machine.
+void QScxmlStateMachinePrivate::externalEventTaken()
+{
+    const int limit = m_externalQueueLimit.loadRelaxed();
+    if (limit == 0)
+        return;
+
+    // Congestion ends when the queue has drained to half its capacity, so that a queue running
+    // close to its capacity does not toggle it with every event.
+    if (m_externalQueue.size() <= limit / 2 && m_externalQueueCongested.value())
+        m_externalQueueCongested.setValue(false);
+    if (!m_stalledChannels.empty())
+        resumeStalledChannels();
+}
+
+void QScxmlStateMachinePrivate::resumeStalledChannels()
+{
+    std::vector<std::shared_ptr<QScxmlInternal::EventChannel>> channels;
+    channels.swap(m_stalledChannels);
+    for (const auto &channel : channels)
+        channel->resume();
+}
+
+void QScxmlStateMachinePrivate::queueLimitsChanged()
+{
+    const int limit = qMax(m_externalQueueCapacity.value(), 0);
+    m_externalQueueLimit.storeRelaxed(limit);
+    m_blockSenders.storeRelaxed(
+                m_queueOverflowPolicy.value() == QScxmlStateMachine::BlockSender ? 1 : 0);
+    m_externalQueueCongested.setValue(limit > 0 && m_externalQueue.size() >= limit);
+    if (!m_stalledChannels.empty())
+        resumeStalledChannels();
 }
 
 void QScxmlStateMachinePrivate::submitDelayedEvent(QScxmlEvent *event)
@@ -596,7 +1169,7 @@ void QScxmlStateMachinePrivate::submitDelayedEvent(QScxmlEvent *event)
     Q_ASSERT(event);
     Q_ASSERT(event->delay() > 0);
 
-    const int timerId = m_eventLoopHook.startTimer(event->delay());
+    const int timerId = startDelayTimer(event->delay());
     if (timerId == 0) {
         qWarning("QScxmlStateMachinePrivate::submitDelayedEvent: "
                  "failed to start timer for event '%s' (%p)",
@@ -605,12 +1178,113 @@ void QScxmlStateMachinePrivate::submitDelayedEvent(QScxmlEvent *event)
         return;
     }
     m_delayedEvents.push_back(std::make_pair(timerId, event));
+    delayedEventsChanged();
 
     qCDebug(qscxmlLog) << q_func()
                        << ": delayed event" << event->name()
                        << "(" << event << ") got id:" << timerId;
 }
 
+void QScxmlStateMachinePrivate::fireDelayedEvent(size_t index)
+{
+    const auto delayedEvent = m_delayedEvents[index];
+    if (Q_UNLIKELY(m_eventLog))
+        m_eventLog->writeDelayedEventFired(int(index));
+    m_delayedEvents.erase(m_delayedEvents.begin() + index);
+    delayedEventsChanged();
+    killDelayTimer(delayedEvent.first);
+    routeEvent(delayedEvent.second);
+}
+
+void QScxmlStateMachinePrivate::delayTimerFired(int timerId)
+{
+    for (size_t i = 0, ei = m_delayedEvents.size(); i != ei; ++i) {
+        if (m_delayedEvents[i].first == timerId) {
+            fireDelayedEvent(i);
+            return;
+        }
+    }
+}
+
+// While an event log is replayed, the log decides when delayed events are due. They get negative
+// ids then, which cannot clash with the ids of real timers.
+int QScxmlStateMachinePrivate::startDelayTimer(int delay)
+{
+    if (m_replaying)
+        return --m_virtualTimerId;
+    if (m_clock)
+        return m_clock->startTimer(q_func(), delay);
+    return m_eventLoopHook.startTimer(delay);
+}
+
+void QScxmlStateMachinePrivate::killDelayTimer(int timerId)
+{
+    if (timerId <= 0)
+        return;
+    if (m_clock)
+        m_clock->killTimer(timerId);
+    else
+        m_eventLoopHook.killTimer(timerId);
+}
+
+int QScxmlStateMachinePrivate::remainingDelay(int timerId) const
+{
+    if (timerId <= 0)
+        return 0;
+    if (m_clock)
+        return qMax(m_clock->remainingTime(timerId), 0);
+    QAbstractEventDispatcher *dispatcher
+            = QAbstractEventDispatcher::instance(m_eventLoopHook.thread());
+    return dispatcher ? qMax(dispatcher->remainingTime(timerId), 0) : 0;
+}
+
+void QScxmlStateMachinePrivate::setClock(QScxmlInternal::Clock *clock)
+{
+    if (clock == m_clock)
+        return;
+
+    std::vector<int> remaining;
+    remaining.reserve(m_delayedEvents.size());
+    for (const auto &delayedEvent : m_delayedEvents) {
+        remaining.push_back(remainingDelay(delayedEvent.first));
+        killDelayTimer(delayedEvent.first);
+    }
+
+    m_clock = clock;
+
+    size_t i = 0;
+    for (auto it = m_delayedEvents.begin(); it != m_delayedEvents.end(); ++i) {
+        if (it->first > 0) {
+            it->first = startDelayTimer(remaining[i]);
+            if (it->first == 0) {
+                delete it->second;
+                it = m_delayedEvents.erase(it);
+                continue;
+            }
+        }
+        ++it;
+    }
+    delayedEventsChanged();
+}
+
+// Gives the delayed events that are still pending after a replay real timers, with their full
+// delay.
+void QScxmlStateMachinePrivate::restartDelayTimers()
+{
+    for (auto it = m_delayedEvents.begin(); it != m_delayedEvents.end();) {
+        if (it->first < 0) {
+            it->first = startDelayTimer(it->second->delay());
+            if (it->first == 0) {
+                delete it->second;
+                it = m_delayedEvents.erase(it);
+                continue;
+            }
+        }
+        ++it;
+    }
+    delayedEventsChanged();
+}
+
 /*!
  * Submits an error event to the external event queue of this state machine.
  *
@@ -627,7 +1301,7 @@ void QScxmlStateMachinePrivate::submitError(const QString &type, const QString &
     qCDebug(qscxmlLog) << q << "had error" << type << ":" << message;
     if (!type.startsWith(QStringLiteral("error.")))
         qCWarning(qscxmlLog) << q << "Message type of error message does not start with 'error.'!";
-    q->submitEvent(QScxmlEventBuilder::errorEvent(q, type, message, sendId));
+    submitEvent(QScxmlEventBuilder::errorEvent(q, type, message, sendId));
 }
 
 void QScxmlStateMachinePrivate::start()
@@ -664,6 +1338,9 @@ void QScxmlStateMachinePrivate::processEvents()
 
     Q_Q(QScxmlStateMachine);
     qCDebug(qscxmlLog) << q_func() << "starting macrostep";
+    trace(QScxmlInternal::TraceRecord::MacrostepBegin);
+    if (Q_UNLIKELY(m_eventLog))
+        m_eventLog->writeMacrostep();
 
     while (isRunnable() && !isPaused()) {
         if (m_runningState == Starting) {
@@ -676,12 +1353,15 @@ void QScxmlStateMachinePrivate::processEvents()
         OrderedSet enabledTransitions;
         std::vector<int> configurationInDocumentOrder = m_configuration.list();
         std::sort(configurationInDocumentOrder.begin(), configurationInDocumentOrder.end());
-        selectTransitions(enabledTransitions, configurationInDocumentOrder, nullptr);
+        if (m_activeEventlessStates > 0)
+            selectTransitions(enabledTransitions, configurationInDocumentOrder, nullptr);
         if (!enabledTransitions.isEmpty()) {
             microstep(enabledTransitions);
         } else if (!m_internalQueue.isEmpty()) {
             auto event = m_internalQueue.dequeue();
+            QScxmlInternal::Metrics::add(m_metrics.internalEvents);
             setEvent(event);
+            traceEvent(event);
             selectTransitions(enabledTransitions, configurationInDocumentOrder, event);
             if (!enabledTransitions.isEmpty()) {
                 microstep(enabledTransitions);
@@ -690,7 +1370,10 @@ void QScxmlStateMachinePrivate::processEvents()
             delete event;
         } else if (!m_externalQueue.isEmpty()) {
             auto event = m_externalQueue.dequeue();
+            QScxmlInternal::Metrics::add(m_metrics.externalEvents);
+            externalEventTaken();
             setEvent(event);
+            traceEvent(event);
             selectTransitions(enabledTransitions, configurationInDocumentOrder, event);
             if (!enabledTransitions.isEmpty()) {
                 microstep(enabledTransitions);
@@ -712,6 +1395,8 @@ void QScxmlStateMachinePrivate::processEvents()
     qCDebug(qscxmlLog) << q_func()
                        << "finished macrostep, runnable:" << isRunnable()
                        << "paused:" << isPaused();
+    trace(QScxmlInternal::TraceRecord::MacrostepEnd);
+    m_metrics.finishMacrostep();
     emit q->reachedStableState();
     if (!isRunnable() && !isPaused()) {
         exitInterpreter();
@@ -780,7 +1465,7 @@ void QScxmlStateMachinePrivate::updateMetaCache()
         const auto &s = m_stateTable->state(i);
         if (!s.isHistoryState() && s.type != StateTable::State::Invalid) {
             m_stateIndexToSignalIndex.insert(i, signalIndex);
-            m_stateNameToSignalIndex.insert(m_tableData.value()->string(s.name),
+            m_stateNameToSignalIndex.insert(string(s.name),
                                             signalIndex + methodOffset);
 
             ++signalIndex;
@@ -788,23 +1473,175 @@ void QScxmlStateMachinePrivate::updateMetaCache()
     }
 }
 
+void QScxmlStateMachinePrivate::updateHistoryCache()
+{
+    m_historyChildOffsets.clear();
+    m_historyChildren.clear();
+    m_historyRecordIndex.clear();
+    m_historyRecords.clear();
+    m_historyStorage.clear();
+
+    if (!m_tableData.value())
+        return;
+
+    if (!m_stateTable)
+        return;
+
+    const int stateCount = m_stateTable->stateCount;
+
+    // States are in document order, so the descendants of s are s + 1 up to lastDescendant[s].
+    std::vector<int> lastDescendant(stateCount);
+    for (int i = 0; i < stateCount; ++i)
+        lastDescendant[i] = i;
+    for (int i = stateCount - 1; i >= 0; --i) {
+        const int parent = m_stateTable->state(i).parent;
+        if (parent != StateTable::InvalidIndex)
+            lastDescendant[parent] = std::max(lastDescendant[parent], lastDescendant[i]);
+    }
+
+    m_historyChildOffsets.assign(stateCount + 1, 0);
+    m_historyRecordIndex.assign(stateCount, -1);
+    for (int i = 0; i < stateCount; ++i) {
+        const auto &state = m_stateTable->state(i);
+        if (state.isHistoryState() && state.parent != StateTable::InvalidIndex)
+            ++m_historyChildOffsets[state.parent + 1];
+    }
+    for (int i = 0; i < stateCount; ++i)
+        m_historyChildOffsets[i + 1] += m_historyChildOffsets[i];
+    m_historyChildren.resize(m_historyChildOffsets[stateCount]);
+
+    std::vector<int> next(m_historyChildOffsets.begin(), m_historyChildOffsets.end() - 1);
+    for (int i = 0; i < stateCount; ++i) {
+        const auto &state = m_stateTable->state(i);
+        if (!state.isHistoryState() || state.parent == StateTable::InvalidIndex)
+            continue;
+
+        m_historyChildren[next[state.parent]++] = i;
+
+        HistoryRecord record;
+        record.parent = state.parent;
+        record.firstCandidate = state.parent + 1;
+        record.lastCandidate = lastDescendant[state.parent];
+        record.deep = state.type == StateTable::State::DeepHistory;
+        record.capacity = 0;
+        for (int j = record.firstCandidate; j <= record.lastCandidate; ++j) {
+            const auto &candidate = m_stateTable->state(j);
+            if (candidate.isHistoryState())
+                continue;
+            if (record.deep ? candidate.isAtomic() : candidate.parent == record.parent)
+                ++record.capacity;
+        }
+        record.offset = int(m_historyStorage.size());
+        record.count = -1;
+        m_historyStorage.resize(m_historyStorage.size() + size_t(record.capacity));
+        m_historyRecordIndex[i] = int(m_historyRecords.size());
+        m_historyRecords.push_back(record);
+    }
+}
+
+void QScxmlStateMachinePrivate::updateTransitionCache()
+{
+    m_hasEventlessTransitions.clear();
+    m_eventlessInAncestry.clear();
+    m_activeEventlessStates = 0;
+    m_eventDescriptors.clear();
+    m_eventTransitionOffsets.clear();
+    m_eventTransitions.clear();
+
+    if (!m_tableData.value() || !m_stateTable)
+        return;
+
+    const int stateCount = m_stateTable->stateCount;
+    m_hasEventlessTransitions.assign(size_t(stateCount), 0);
+    m_eventlessInAncestry.assign(size_t(stateCount), 0);
+    m_eventTransitionOffsets.reserve(size_t(stateCount) + 1);
+
+    // Parents come before their children in document order.
+    for (int i = 0; i < stateCount; ++i) {
+        const auto &state = m_stateTable->state(i);
+        const StateTable::Array transitions = m_stateTable->array(state.transitions);
+        const size_t first = m_eventTransitions.size();
+        m_eventTransitionOffsets.push_back(int(first));
+        if (transitions.isValid()) {
+            for (int position = 0; position < transitions.size(); ++position) {
+                const auto &t = m_stateTable->transition(transitions[position]);
+                if (t.events == StateTable::InvalidIndex) {
+                    m_hasEventlessTransitions[size_t(i)] = 1;
+                    continue;
+                }
+                for (int eventName : m_stateTable->array(t.events)) {
+                    QString descriptor = string(eventName);
+                    int id = WildcardDescriptor;
+                    if (descriptor != QStringLiteral("*")) {
+                        if (descriptor.endsWith(QStringLiteral(".*")))
+                            descriptor.chop(2);
+                        id = m_eventDescriptors.value(descriptor, -1);
+                        if (id == -1) {
+                            id = int(m_eventDescriptors.size());
+                            m_eventDescriptors.insert(descriptor, id);
+                        }
+                    }
+                    m_eventTransitions.push_back({ id, position });
+                }
+            }
+        }
+        std::sort(m_eventTransitions.begin() + first, m_eventTransitions.end(),
+                  [](const EventTransition &a, const EventTransition &b) {
+            return a.descriptor < b.descriptor
+                    || (a.descriptor == b.descriptor && a.position < b.position);
+        });
+        // A transition listing both "a" and "a.*" would otherwise be tried twice for one event.
+        m_eventTransitions.erase(std::unique(m_eventTransitions.begin() + first,
+                                             m_eventTransitions.end(),
+                                             [](const EventTransition &a,
+                                                const EventTransition &b) {
+            return a.descriptor == b.descriptor && a.position == b.position;
+        }), m_eventTransitions.end());
+        m_eventlessInAncestry[size_t(i)] = m_hasEventlessTransitions[size_t(i)]
+                || (state.parent != StateTable::InvalidIndex
+                    && m_eventlessInAncestry[size_t(state.parent)]);
+    }
+    m_eventTransitionOffsets.push_back(int(m_eventTransitions.size()));
+
+    for (int stateIndex : m_configuration)
+        m_activeEventlessStates += m_hasEventlessTransitions[size_t(stateIndex)];
+}
+
 QStringList QScxmlStateMachinePrivate::stateNames(const std::vector<int> &stateIndexes) const
 {
     QStringList names;
     for (int idx : stateIndexes)
-        names.append(m_tableData.value()->string(m_stateTable->state(idx).name));
+        names.append(string(m_stateTable->state(idx).name));
     return names;
 }
 
-std::vector<int> QScxmlStateMachinePrivate::historyStates(int stateIdx) const {
-    const StateTable::Array kids = m_stateTable->array(m_stateTable->state(stateIdx).childStates);
-    std::vector<int> res;
-    if (!kids.isValid()) return res;
-    for (int k : kids) {
-        if (m_stateTable->state(k).isHistoryState())
-            res.push_back(k);
+void QScxmlStateMachinePrivate::recordHistory(int historyState)
+{
+    HistoryRecord &record = m_historyRecords[m_historyRecordIndex[historyState]];
+    int *value = m_historyStorage.data() + record.offset;
+    int count = 0;
+    for (int s0 : m_configuration) {
+        if (s0 < record.firstCandidate || s0 > record.lastCandidate)
+            continue;
+        const auto &s0State = m_stateTable->state(s0);
+        if (record.deep ? s0State.isAtomic() : s0State.parent == record.parent) {
+            Q_ASSERT(count < record.capacity);
+            value[count++] = s0;
+        }
     }
-    return res;
+    record.count = count;
+}
+
+QScxmlStateMachinePrivate::HistoryValue
+QScxmlStateMachinePrivate::historyValue(int historyState) const
+{
+    HistoryValue result;
+    const HistoryRecord &record = m_historyRecords[m_historyRecordIndex[historyState]];
+    if (record.count != -1) {
+        result.first = m_historyStorage.data() + record.offset;
+        result.last = result.first + record.count;
+    }
+    return result;
 }
 
 void QScxmlStateMachinePrivate::exitInterpreter()
@@ -812,18 +1649,21 @@ void QScxmlStateMachinePrivate::exitInterpreter()
     qCDebug(qscxmlLog) << q_func() << "exiting SCXML processing";
 
     for (auto it : m_delayedEvents) {
-        m_eventLoopHook.killTimer(it.first);
+        killDelayTimer(it.first);
         delete it.second;
     }
     m_delayedEvents.clear();
+    delayedEventsChanged();
 
     auto statesToExitSorted = m_configuration.list();
     std::sort(statesToExitSorted.begin(), statesToExitSorted.end(), std::greater<int>());
     for (int stateIndex : statesToExitSorted) {
         const auto &state = m_stateTable->state(stateIndex);
         if (state.exitInstructions != StateTable::InvalidIndex) {
-            m_executionEngine->execute(state.exitInstructions);
+            execute(stateIndex, state.exitInstructions);
         }
+        trace(QScxmlInternal::TraceRecord::StateExited, stateIndex);
+        m_profile.stateExited(stateIndex);
         removeService(stateIndex);
         if (state.type == StateTable::State::Final && state.parentIsScxmlElement()) {
             returnDoneEvent(state.doneData);
@@ -840,7 +1680,7 @@ void QScxmlStateMachinePrivate::returnDoneEvent(QScxmlExecutableContent::Contain
         auto e = new QScxmlEvent;
         e->setName(QStringLiteral("done.invoke.") + q->sessionId());
         e->setInvokeId(q->sessionId());
-        QScxmlStateMachinePrivate::get(m_parentStateMachine)->postEvent(e);
+        sendToParent(e);
     }
 }
 
@@ -850,7 +1690,7 @@ bool QScxmlStateMachinePrivate::nameMatch(const StateTable::Array &patterns,
     const QString eventName = event->name();
     bool selected = false;
     for (int eventSelectorIter = 0; eventSelectorIter < patterns.size(); ++eventSelectorIter) {
-        QString eventStr = m_tableData.value()->string(patterns[eventSelectorIter]);
+        QString eventStr = string(patterns[eventSelectorIter]);
         if (eventStr == QStringLiteral("*")) {
             selected = true;
             break;
@@ -870,6 +1710,30 @@ bool QScxmlStateMachinePrivate::nameMatch(const StateTable::Array &patterns,
     return selected;
 }
 
+// Collects the interned descriptors matching eventName: those equal to the whole name, or to a
+// part of it that is followed by a '.' or a '(', which is what nameMatch() accepts.
+void QScxmlStateMachinePrivate::matchingDescriptors(const QString &eventName,
+                                                    QVarLengthArray<int, 8> *descriptors) const
+{
+    descriptors->clear();
+    descriptors->append(WildcardDescriptor);
+    if (m_eventDescriptors.isEmpty())
+        return;
+
+    auto lookup = [&](qsizetype length) {
+        const int id = m_eventDescriptors.value(
+                    lookupKey(QStringView(eventName).left(length)), -1);
+        if (id != -1)
+            descriptors->append(id);
+    };
+    for (qsizetype i = 0, ei = eventName.size(); i < ei; ++i) {
+        const QChar c = eventName.at(i);
+        if (c == QLatin1Char('.') || c == QLatin1Char('('))
+            lookup(i);
+    }
+    lookup(eventName.size());
+}
+
 void QScxmlStateMachinePrivate::selectTransitions(OrderedSet &enabledTransitions,
                                                   const std::vector<int> &configInDocumentOrder,
                                                   QScxmlEvent *event) const
@@ -881,9 +1745,15 @@ void QScxmlStateMachinePrivate::selectTransitions(OrderedSet &enabledTransitions
                            << QScxmlEventPrivate::debugString(event).constData();
     }
 
+    QVarLengthArray<int, 8> descriptors;
+    if (event != nullptr)
+        matchingDescriptors(event->name(), &descriptors);
+
     std::vector<int> states;
     states.reserve(16);
     for (int configStateIdx : configInDocumentOrder) {
+        if (event == nullptr && !m_eventlessInAncestry[size_t(configStateIdx)])
+            continue;
         if (m_stateTable->state(configStateIdx).isAtomic()) {
             states.clear();
             states.push_back(configStateIdx);
@@ -900,34 +1770,56 @@ void QScxmlStateMachinePrivate::selectTransitions(OrderedSet &enabledTransitions
                 const StateTable::Array transitions = m_stateTable->array(state.transitions);
                 if (!transitions.isValid())
                     continue;
-                std::vector<int> sortedTransitions(transitions.size(), -1);
-                std::copy(transitions.begin(), transitions.end(), sortedTransitions.begin());
-                for (int transitionIndex : sortedTransitions) {
+
+                auto isEnabled = [&](int transitionIndex) {
                     const StateTable::Transition &t = m_stateTable->transition(transitionIndex);
-                    bool enabled = false;
-                    if (event == nullptr) {
-                        if (t.events == -1) {
-                            if (t.condition == -1) {
-                                enabled = true;
-                            } else {
-                                bool ok = false;
-                                enabled = m_dataModel.value()->evaluateToBool(t.condition, &ok) && ok;
-                            }
-                        }
-                    } else {
-                        if (t.events != -1 && nameMatch(m_stateTable->array(t.events), event)) {
-                            if (t.condition == -1) {
-                                enabled = true;
-                            } else {
-                                bool ok = false;
-                                enabled = m_dataModel.value()->evaluateToBool(t.condition, &ok) && ok;
-                            }
+                    return t.condition == -1 || evaluateGuard(transitionIndex, t.condition);
+                };
+
+                if (event == nullptr) {
+                    for (int transitionIndex : transitions) {
+                        if (m_stateTable->transition(transitionIndex).events == -1
+                                && isEnabled(transitionIndex)) {
+                            enabledTransitions.add(transitionIndex);
+                            finishedWithThisConfigState = true;
+                            break; // stop iterating over transitions
                         }
                     }
-                    if (enabled) {
-                        enabledTransitions.add(transitionIndex);
-                        finishedWithThisConfigState = true;
-                        break; // stop iterating over transitions
+                } else {
+                    // Gather the positions of the transitions matching the event, and try them in
+                    // document order.
+                    const auto first = m_eventTransitions.cbegin()
+                            + m_eventTransitionOffsets[size_t(stateIdx)];
+                    const auto last = m_eventTransitions.cbegin()
+                            + m_eventTransitionOffsets[size_t(stateIdx) + 1];
+                    QVarLengthArray<int, 16> candidates;
+                    int ranges = 0;
+                    for (int descriptor : descriptors) {
+                        auto it = std::lower_bound(first, last, descriptor,
+                                                   [](const EventTransition &et, int d) {
+                            return et.descriptor < d;
+                        });
+                        if (it == last || it->descriptor != descriptor)
+                            continue;
+                        ++ranges;
+                        for (; it != last && it->descriptor == descriptor; ++it)
+                            candidates.append(it->position);
+                    }
+                    if (ranges > 1) {
+                        std::sort(candidates.begin(), candidates.end());
+                        candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                                         candidates.end());
+                    }
+                    for (int position : candidates) {
+                        const int transitionIndex = transitions[position];
+                        Q_ASSERT(nameMatch(m_stateTable->array(
+                                               m_stateTable->transition(transitionIndex).events),
+                                           event));
+                        if (isEnabled(transitionIndex)) {
+                            enabledTransitions.add(transitionIndex);
+                            finishedWithThisConfigState = true;
+                            break; // stop iterating over transitions
+                        }
                     }
                 }
 
@@ -1035,23 +1927,32 @@ void QScxmlStateMachinePrivate::microstep(const OrderedSet &enabledTransitions)
             const auto &transition = m_stateTable->transition(t);
             QString from = QStringLiteral("(none)");
             if (transition.source != StateTable::InvalidIndex)
-                from = m_tableData.value()->string(m_stateTable->state(transition.source).name);
+                from = string(m_stateTable->state(transition.source).name);
             QStringList to;
             if (transition.targets == StateTable::InvalidIndex) {
                 to.append(QStringLiteral("(none)"));
             } else {
                 for (int t : m_stateTable->array(transition.targets))
-                    to.append(m_tableData.value()->string(m_stateTable->state(t).name));
+                    to.append(string(m_stateTable->state(t).name));
             }
             qCDebug(qscxmlLog) << q_func() << "\t" << t << ":" << from << "->"
                                << to.join(QLatin1Char(','));
         }
     }
 
+    trace(QScxmlInternal::TraceRecord::MicrostepBegin, 0, enabledTransitions.count());
+    for (int t : enabledTransitions) {
+        trace(QScxmlInternal::TraceRecord::TransitionTaken, t);
+        m_profile.transitionTaken(t);
+    }
+
     exitStates(enabledTransitions);
     executeTransitionContent(enabledTransitions);
     enterStates(enabledTransitions);
 
+    trace(QScxmlInternal::TraceRecord::MicrostepEnd);
+    ++m_metrics.currentMicrosteps;
+
     qCDebug(qscxmlLog) << q_func() << "finished microstep, configuration:"
                        << stateNames(m_configuration.list());
 }
@@ -1069,29 +1970,17 @@ void QScxmlStateMachinePrivate::exitStates(const OrderedSet &enabledTransitions)
             m_statesToInvoke.remove(s);
     }
     for (int s : statesToExitSorted) {
-        for (int h : historyStates(s)) {
-            const auto &hState = m_stateTable->state(h);
-            QList<int> history;
-
-            for (int s0 : m_configuration) {
-                const auto &s0State = m_stateTable->state(s0);
-                if (hState.type == StateTable::State::DeepHistory) {
-                    if (s0State.isAtomic() && isDescendant(s0, s))
-                        history.append(s0);
-                } else {
-                    if (s0State.parent == s)
-                        history.append(s0);
-                }
-            }
-
-            m_historyValue[h] = history;
-        }
+        for (int i = m_historyChildOffsets[s], ei = m_historyChildOffsets[s + 1]; i != ei; ++i)
+            recordHistory(m_historyChildren[i]);
     }
     for (int s : statesToExitSorted) {
         const auto &state = m_stateTable->state(s);
         if (state.exitInstructions != StateTable::InvalidIndex)
-            m_executionEngine->execute(state.exitInstructions);
-        m_configuration.remove(s);
+            execute(s, state.exitInstructions);
+        if (m_configuration.remove(s))
+            m_activeEventlessStates -= m_hasEventlessTransitions[size_t(s)];
+        trace(QScxmlInternal::TraceRecord::StateExited, s);
+        m_profile.stateExited(s);
         emitStateActive(s, false);
         removeService(s);
     }
@@ -1125,7 +2014,7 @@ void QScxmlStateMachinePrivate::executeTransitionContent(const OrderedSet &enabl
     for (int t : enabledTransitions) {
         const auto &transition = m_stateTable->transition(t);
         if (transition.transitionInstructions != StateTable::InvalidIndex)
-            m_executionEngine->execute(transition.transitionInstructions);
+            execute(transition.source, transition.transitionInstructions);
     }
 
     if (m_infoSignalProxy) {
@@ -1148,24 +2037,27 @@ void QScxmlStateMachinePrivate::enterStates(const OrderedSet &enabledTransitions
     qCDebug(qscxmlLog) << q_func() << "entering states" << stateNames(sortedStates);
     for (int s : sortedStates) {
         const auto &state = m_stateTable->state(s);
-        m_configuration.add(s);
+        if (m_configuration.add(s))
+            m_activeEventlessStates += m_hasEventlessTransitions[size_t(s)];
+        trace(QScxmlInternal::TraceRecord::StateEntered, s);
+        m_profile.stateEntered(s);
         if (state.serviceFactoryIds != StateTable::InvalidIndex)
             m_statesToInvoke.insert(s);
         if (m_stateTable->binding == StateTable::LateBinding && m_isFirstStateEntry[s]) {
             if (state.initInstructions != StateTable::InvalidIndex)
-                m_executionEngine->execute(state.initInstructions);
+                execute(s, state.initInstructions);
             m_isFirstStateEntry[s] = false;
         }
         if (state.entryInstructions != StateTable::InvalidIndex)
-            m_executionEngine->execute(state.entryInstructions);
+            execute(s, state.entryInstructions);
         if (statesForDefaultEntry.contains(s)) {
             const auto &initialTransition = m_stateTable->transition(state.initialTransition);
             if (initialTransition.transitionInstructions != StateTable::InvalidIndex)
-                m_executionEngine->execute(initialTransition.transitionInstructions);
+                execute(s, initialTransition.transitionInstructions);
         }
         const int dhc = defaultHistoryContent.value(s);
         if (dhc != StateTable::InvalidIndex)
-            m_executionEngine->execute(dhc);
+            execute(s, dhc);
         if (state.type == StateTable::State::Final) {
             if (state.parentIsScxmlElement()) {
                 bool running = isRunnable() && !isPaused();
@@ -1174,7 +2066,7 @@ void QScxmlStateMachinePrivate::enterStates(const OrderedSet &enabledTransitions
                     emit q->runningChanged(false);
             } else {
                 const auto &parent = m_stateTable->state(state.parent);
-                m_executionEngine->execute(state.doneData, m_tableData.value()->string(parent.name));
+                execute(s, state.doneData, string(parent.name));
                 if (parent.parent != StateTable::InvalidIndex) {
                     const auto &grandParent = m_stateTable->state(parent.parent);
                     if (grandParent.isParallel()) {
@@ -1182,8 +2074,8 @@ void QScxmlStateMachinePrivate::enterStates(const OrderedSet &enabledTransitions
                             auto e = new QScxmlEvent;
                             e->setEventType(QScxmlEvent::InternalEvent);
                             e->setName(QStringLiteral("done.state.")
-                                       + m_tableData.value()->string(grandParent.name));
-                            q->submitEvent(e);
+                                       + string(grandParent.name));
+                            submitEvent(e);
                         }
                     }
                 }
@@ -1235,13 +2127,12 @@ void QScxmlStateMachinePrivate::addDescendantStatesToEnter(
 
     const auto &state = m_stateTable->state(stateIndex);
     if (state.isHistoryState()) {
-        HistoryValues::const_iterator historyValueIter = m_historyValue.find(stateIndex);
-        if (historyValueIter != m_historyValue.end()) {
-            auto historyValue = historyValueIter.value();
-            for (int s : historyValue)
+        const HistoryValue history = historyValue(stateIndex);
+        if (history.isValid()) {
+            for (int s : history)
                 addDescendantStatesToEnter(s, statesToEnter, statesForDefaultEntry,
                                            defaultHistoryContent);
-            for (int s : historyValue)
+            for (int s : history)
                 addAncestorStatesToEnter(s, state.parent, statesToEnter, statesForDefaultEntry,
                                          defaultHistoryContent);
         } else {
@@ -1458,9 +2349,9 @@ void QScxmlStateMachinePrivate::getEffectiveTargetStates(OrderedSet *targets,
     for (int s : m_stateTable->array(transition.targets)) {
         const auto &state = m_stateTable->state(s);
         if (state.isHistoryState()) {
-            HistoryValues::const_iterator historyValueIter = m_historyValue.find(s);
-            if (historyValueIter != m_historyValue.end()) {
-                for (int historyState : historyValueIter.value()) {
+            const HistoryValue history = historyValue(s);
+            if (history.isValid()) {
+                for (int historyState : history) {
                     targets->add(historyState);
                 }
             } else if (state.transitions != StateTable::InvalidIndex) {
@@ -1805,15 +2696,20 @@ void QScxmlStateMachine::setTableData(QScxmlTableData *tableData)
     }
 
     d->m_tableData = tableData;
+    d->m_staticTables = nullptr;
+    d->m_traceId = 0;
+    d->m_metrics.resize(0);
+    d->m_profile.disable();
     if (tableData) {
         d->m_stateTable = reinterpret_cast<const QScxmlExecutableContent::StateTable *>(
                     tableData->stateMachineTable());
+        d->m_metrics.resize(d->m_stateTable->stateCount);
         if (objectName().isEmpty()) {
             setObjectName(tableData->name());
         }
         if (d->m_stateTable->maxServiceId != QScxmlExecutableContent::StateTable::InvalidIndex) {
             const size_t serviceCount = size_t(d->m_stateTable->maxServiceId + 1);
-            d->m_invokedServices.resize(serviceCount, { -1, nullptr, QString() });
+            d->m_invokedServices.resize(serviceCount, { -1, nullptr, QString(), QString() });
             d->m_cachedFactories.resize(serviceCount, nullptr);
         }
 
@@ -1827,6 +2723,8 @@ void QScxmlStateMachine::setTableData(QScxmlTableData *tableData)
     }
 
     d->updateMetaCache();
+    d->updateHistoryCache();
+    d->updateTransitionCache();
 
     d->m_tableData.notify();
     emit tableDataChanged(tableData);
@@ -1874,7 +2772,7 @@ QStringList QScxmlStateMachine::stateNames(bool compress) const
     for (int i = 0; i < d->m_stateTable->stateCount; ++i) {
         const auto &state = d->m_stateTable->state(i);
         if (!compress || state.isAtomic())
-            names.append(d->m_tableData.value()->string(state.name));
+            names.append(d->string(state.name));
     }
     return names;
 }
@@ -1905,7 +2803,7 @@ QStringList QScxmlStateMachine::activeStateNames(bool compress) const
     for (int stateIdx : d->m_configuration) {
         const auto &state = d->m_stateTable->state(stateIdx);
         if (state.isAtomic() || !compress)
-            result.append(d->m_tableData.value()->string(state.name));
+            result.append(d->string(state.name));
     }
     return result;
 }
@@ -1926,7 +2824,7 @@ bool QScxmlStateMachine::isActive(const QString &scxmlStateName) const
 
     for (int stateIndex : d->m_configuration) {
         const auto &state = d->m_stateTable->state(stateIndex);
-        if (d->m_tableData.value()->string(state.name) == scxmlStateName)
+        if (d->string(state.name) == scxmlStateName)
             return true;
     }
 
@@ -2035,13 +2933,7 @@ bool QScxmlStateMachine::init()
     if (d->m_isInitialized.value())
         return false;
 
-    if (!parseErrors().isEmpty())
-        return false;
-
-    if (!dataModel() || !dataModel()->setup(d->m_initialValues.value()))
-        return false;
-
-    if (!d->executeInitialSetup())
+    if (!d->setupDataModel() || !d->executeInitialSetup())
         return false;
 
     d->m_isInitialized.setValue(true);
@@ -2073,6 +2965,239 @@ void QScxmlStateMachine::setRunning(bool running)
         stop();
 }
 
+/*!
+    \property QScxmlStateMachine::threadedInvocation
+    \since 6.4
+
+    \brief Whether state machines invoked by this one run on worker threads.
+
+    By default, a state machine started by an \c <invoke> element lives on the
+    thread of the state machine that invoked it. If this property is \c true,
+    each SCXML service invoked from then on is moved to one of a set of worker
+    threads shared by all state machines, so that independent child state
+    machines can run in parallel. The child state machine is set up and started
+    on its worker thread. Events between the parent and the child are queued,
+    and events sent in one direction are received in the order they were sent.
+
+    The state machine returned by the service's \c stateMachine property then
+    lives on the worker thread, and must only be accessed from there. Child
+    state machines invoked on worker threads are not reused by later
+    invocations.
+
+    The default is \c false.
+*/
+
+bool QScxmlStateMachine::isThreadedInvocation() const
+{
+    Q_D(const QScxmlStateMachine);
+    return d->m_threadedInvocation;
+}
+
+void QScxmlStateMachine::setThreadedInvocation(bool threaded)
+{
+    Q_D(QScxmlStateMachine);
+    d->m_threadedInvocation = threaded;
+}
+
+QBindable<bool> QScxmlStateMachine::bindableThreadedInvocation()
+{
+    Q_D(QScxmlStateMachine);
+    return &d->m_threadedInvocation;
+}
+
+/*!
+    \enum QScxmlStateMachine::QueueOverflowPolicy
+    \since 6.4
+
+    This enum specifies what happens to an event that arrives while the
+    external event queue holds externalQueueCapacity events.
+
+    \value RejectEvent The event is discarded, and an \c error.communication
+           event is placed in the internal event queue.
+    \value DropOldestEvent The oldest event in the queue is discarded to make
+           room for the new one. Normal priority events are discarded before
+           high priority ones.
+    \value BlockSender Invoked state machines running on other threads wait
+           in their \c <send> until the queue has room. Events from the state
+           machine's own thread are rejected as with RejectEvent. A sender that
+           another thread is waiting for does not wait, so that two state
+           machines sending to each other cannot block each other, and no
+           sender waits longer than five seconds. After that, the event is
+           rejected and the sender gets an \c error.communication event.
+
+    \sa externalQueueCapacity, queueOverflowPolicy
+*/
+
+/*!
+    \enum QScxmlStateMachine::SubmitResult
+    \since 6.4
+
+    This enum describes what happened to an event passed to trySubmitEvent().
+
+    \value EventAccepted The event was queued, or scheduled if it has a delay.
+    \value EventRejected The event was discarded.
+    \value OldestEventDropped The event was queued, and the oldest event in
+           the external queue was discarded to make room for it.
+    \value EventCoalesced The event replaced the content of a queued event,
+           see setEventCoalescing().
+*/
+
+/*!
+    \property QScxmlStateMachine::externalQueueCapacity
+    \since 6.4
+
+    \brief The maximum number of events in the external event queue.
+
+    Events that arrive while the queue is full are handled as specified by
+    queueOverflowPolicy. Events in the internal queue and delayed events that
+    are not due yet are not counted. A limit only applies to events arriving
+    after it is set.
+
+    The default is \c 0, which means that the queue is not bounded.
+
+    \sa externalQueueCongested
+*/
+
+int QScxmlStateMachine::externalQueueCapacity() const
+{
+    Q_D(const QScxmlStateMachine);
+    return d->m_externalQueueCapacity;
+}
+
+void QScxmlStateMachine::setExternalQueueCapacity(int capacity)
+{
+    Q_D(QScxmlStateMachine);
+    d->m_externalQueueCapacity = capacity;
+}
+
+QBindable<int> QScxmlStateMachine::bindableExternalQueueCapacity()
+{
+    Q_D(QScxmlStateMachine);
+    return &d->m_externalQueueCapacity;
+}
+
+/*!
+    \property QScxmlStateMachine::queueOverflowPolicy
+    \since 6.4
+
+    \brief What happens to events arriving while the external event queue is
+    full.
+
+    The default is \l RejectEvent.
+
+    \sa externalQueueCapacity
+*/
+
+QScxmlStateMachine::QueueOverflowPolicy QScxmlStateMachine::queueOverflowPolicy() const
+{
+    Q_D(const QScxmlStateMachine);
+    return d->m_queueOverflowPolicy;
+}
+
+void QScxmlStateMachine::setQueueOverflowPolicy(QueueOverflowPolicy policy)
+{
+    Q_D(QScxmlStateMachine);
+    d->m_queueOverflowPolicy = policy;
+}
+
+QBindable<QScxmlStateMachine::QueueOverflowPolicy>
+QScxmlStateMachine::bindableQueueOverflowPolicy()
+{
+    Q_D(QScxmlStateMachine);
+    return &d->m_queueOverflowPolicy;
+}
+
+/*!
+    \property QScxmlStateMachine::externalQueueCongested
+    \since 6.4
+
+    \brief Whether the external event queue is congested.
+
+    The queue becomes congested when it holds externalQueueCapacity events,
+    and stays so until the state machine has taken it down to half its
+    capacity. Components submitting events can pause while the queue is
+    congested, instead of losing events to the queueOverflowPolicy.
+
+    The property is always \c false for an unbounded queue.
+*/
+
+bool QScxmlStateMachine::isExternalQueueCongested() const
+{
+    Q_D(const QScxmlStateMachine);
+    return d->m_externalQueueCongested;
+}
+
+QBindable<bool> QScxmlStateMachine::bindableExternalQueueCongested() const
+{
+    Q_D(const QScxmlStateMachine);
+    return &d->m_externalQueueCongested;
+}
+
+/*!
+    \enum QScxmlStateMachine::EventPriority
+    \since 6.4
+
+    This enum specifies the lane of the external event queue that an event is
+    placed in. Events are taken from the high priority lane as long as it holds
+    any, and in the order they arrived within each lane.
+
+    \value NormalPriority The event is processed after any high priority
+           events.
+    \value HighPriority The event is processed before any normal priority
+           events.
+
+    \sa setEventPriority()
+*/
+
+/*!
+    \since 6.4
+
+    Places external events matching \a eventDescriptor into the lane of the
+    external event queue for \a priority. As in the \c event attribute of a
+    transition, the descriptors \c "a.b" and \c "a.b.*" match the events
+    \c "a.b" and \c "a.b.c", and \c "*" matches all events. The most specific
+    descriptor set with this function or setEventCoalescing() applies to an
+    event.
+
+    Events that are already queued keep their place.
+
+    \sa EventPriority
+*/
+void QScxmlStateMachine::setEventPriority(const QString &eventDescriptor, EventPriority priority)
+{
+    Q_D(QScxmlStateMachine);
+    const QString key = QScxmlStateMachinePrivate::eventRuleKey(eventDescriptor);
+    auto rule = d->m_eventRules.value(key);
+    rule.priority = priority;
+    d->setEventRule(key, rule);
+}
+
+/*!
+    \since 6.4
+
+    Sets whether external events matching \a eventDescriptor are coalesced,
+    depending on \a coalesce. A coalesced event that arrives while an event of
+    the same name is still queued replaces the content of the queued event,
+    which keeps its place in the queue. This suits events that report the
+    latest value of something, where only the most recent one matters.
+
+    If \a keyField is given, only events that also have the same value for
+    this key in their data replace each other. The data has to be a map then.
+
+    trySubmitEvent() returns \l EventCoalesced for an event that replaced a
+    queued one. The descriptor is matched as in setEventPriority().
+*/
+void QScxmlStateMachine::setEventCoalescing(const QString &eventDescriptor, bool coalesce,
+                                            const QString &keyField)
+{
+    Q_D(QScxmlStateMachine);
+    const QString key = QScxmlStateMachinePrivate::eventRuleKey(eventDescriptor);
+    auto rule = d->m_eventRules.value(key);
+    rule.coalesce = coalesce;
+    rule.keyField = coalesce ? keyField : QString();
+    d->setEventRule(key, rule);
+}
+
 QVariantMap QScxmlStateMachine::initialValues()
 {
     Q_D(const QScxmlStateMachine);
@@ -2118,24 +3243,46 @@ QString QScxmlStateMachine::name() const
  */
 void QScxmlStateMachine::submitEvent(QScxmlEvent *event)
 {
-    Q_D(QScxmlStateMachine);
+    trySubmitEvent(event);
+}
 
-    if (!event)
-        return;
+/*!
+    \qmlmethod ScxmlStateMachine::trySubmitEvent(event)
+    \since 6.4
 
-    if (event->delay() > 0) {
-        qCDebug(qscxmlLog) << this << "submitting event" << event->name()
-                           << "with delay" << event->delay() << "ms:"
-                           << QScxmlEventPrivate::debugString(event).constData();
+    Submits the SCXML event \a event like submitEvent(), and returns what
+    happened to it. This tells whether the event was rejected or displaced
+    another one because the external event queue was full.
 
-        Q_ASSERT(event->eventType() == QScxmlEvent::ExternalEvent);
-        d->submitDelayedEvent(event);
-    } else {
-        qCDebug(qscxmlLog) << this << "submitting event" << event->name()
-                           << ":" << QScxmlEventPrivate::debugString(event).constData();
+    \sa externalQueueCapacity, queueOverflowPolicy
+ */
 
-        d->routeEvent(event);
+/*!
+ * \since 6.4
+ *
+ * Submits the SCXML event \a event like submitEvent(), and returns what happened to it. This
+ * tells whether the event was rejected or displaced another one because the external event
+ * queue was full. The state machine takes ownership of \a event in any case.
+ *
+ * \sa externalQueueCapacity, queueOverflowPolicy
+ */
+QScxmlStateMachine::SubmitResult QScxmlStateMachine::trySubmitEvent(QScxmlEvent *event)
+{
+    Q_D(QScxmlStateMachine);
+
+    if (!event)
+        return EventRejected;
+
+    if (Q_UNLIKELY(d->m_replaying)) {
+        qCDebug(qscxmlLog) << this << "ignoring event" << event->name()
+                           << "while replaying an event log";
+        delete event;
+        return EventRejected;
     }
+    if (Q_UNLIKELY(d->m_eventLog))
+        d->m_eventLog->writeEvent(QScxmlInternal::EventLog::SubmittedEvent, event);
+
+    return d->submitEvent(event);
 }
 
 /*!
@@ -2187,9 +3334,10 @@ void QScxmlStateMachine::cancelDelayedEvent(const QString &sendId)
             qCDebug(qscxmlLog) << this
                                << "canceling event" << sendId
                                << "with timer id" << it->first;
-            d->m_eventLoopHook.killTimer(it->first);
+            d->killDelayTimer(it->first);
             delete it->second;
             d->m_delayedEvents.erase(it);
+            d->delayedEventsChanged();
             return;
         }
     }
@@ -2230,21 +3378,19 @@ bool QScxmlStateMachine::isDispatchableTarget(const QString &target) const
 {
     Q_D(const QScxmlStateMachine);
 
-    if (isInvoked() && target == QStringLiteral("#_parent"))
+    if (!target.startsWith(QStringLiteral("#_")))
+        return false;
+
+    const QStringView targetId = QStringView{target}.mid(2);
+    if (isInvoked() && targetId == QLatin1String("parent"))
         return true; // parent state machine, if we're <invoke>d.
-    if (target == QStringLiteral("#_internal")
-            || target == QStringLiteral("#_scxml_%1").arg(sessionId()))
+    if (targetId == QLatin1String("internal")
+            || (targetId.startsWith(QLatin1String("scxml_"))
+                && targetId.mid(6) == d->m_sessionId)) {
         return true; // that's the current state machine
-
-    if (target.startsWith(QStringLiteral("#_"))) {
-        QStringView targetId = QStringView{target}.mid(2);
-        for (auto invokedService : d->m_invokedServices) {
-            if (invokedService.service && invokedService.service->id() == targetId)
-                return true;
-        }
     }
 
-    return false;
+    return d->m_invokedServiceIds.contains(lookupKey(targetId));
 }
 
 /*!
@@ -2400,4 +3546,23 @@ bool QScxmlStateMachine::isActive(int stateIndex) const
     return d->m_configuration.contains(stateIndex);
 }
 
+/*!
+  \since 6.4
+
+  Lets the state machine read the plain \a tables of the current table data
+  directly. This has to be called after setTableData(), and the tables have to
+  describe the same state machine as the table data.
+
+  This method is part of the interface to the compiled representation of SCXML
+  state machines. It should only be used internally and by state machines
+  compiled from SCXML documents.
+ */
+void QScxmlStateMachine::setStaticTables(const QScxmlTableData::StaticTables *tables)
+{
+    Q_D(QScxmlStateMachine);
+    Q_ASSERT(!tables || d->m_tableData.value());
+    Q_ASSERT(!tables || tables->stateMachineTable == d->m_tableData.value()->stateMachineTable());
+    d->m_staticTables = tables;
+}
+
 QT_END_NAMESPACE
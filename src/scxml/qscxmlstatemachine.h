@@ -45,6 +45,7 @@
 #include <QtScxml/qscxmlevent.h>
 #include <QtScxml/qscxmlcompiler.h>
 #include <QtScxml/qscxmlinvokableservice.h>
+#include <QtScxml/qscxmltabledata.h>
 
 #include <QtCore/qlist.h>
 #include <QtCore/qpointer.h>
@@ -84,12 +85,45 @@ class Q_SCXML_EXPORT QScxmlStateMachine: public QObject
                NOTIFY loaderChanged BINDABLE bindableLoader)
     Q_PROPERTY(QScxmlTableData *tableData READ tableData WRITE setTableData
                NOTIFY tableDataChanged BINDABLE bindableTableData)
+    Q_PROPERTY(bool threadedInvocation READ isThreadedInvocation WRITE setThreadedInvocation
+               NOTIFY threadedInvocationChanged BINDABLE bindableThreadedInvocation
+               REVISION(6, 4))
+    Q_PROPERTY(int externalQueueCapacity READ externalQueueCapacity
+               WRITE setExternalQueueCapacity NOTIFY externalQueueCapacityChanged
+               BINDABLE bindableExternalQueueCapacity REVISION(6, 4))
+    Q_PROPERTY(QueueOverflowPolicy queueOverflowPolicy READ queueOverflowPolicy
+               WRITE setQueueOverflowPolicy NOTIFY queueOverflowPolicyChanged
+               BINDABLE bindableQueueOverflowPolicy REVISION(6, 4))
+    Q_PROPERTY(bool externalQueueCongested READ isExternalQueueCongested
+               NOTIFY externalQueueCongestedChanged BINDABLE bindableExternalQueueCongested
+               REVISION(6, 4))
 
 protected:
     explicit QScxmlStateMachine(const QMetaObject *metaObject, QObject *parent = nullptr);
     QScxmlStateMachine(QScxmlStateMachinePrivate &dd, QObject *parent = nullptr);
 
 public:
+    enum QueueOverflowPolicy {
+        RejectEvent,
+        DropOldestEvent,
+        BlockSender
+    };
+    Q_ENUM(QueueOverflowPolicy)
+
+    enum SubmitResult {
+        EventAccepted,
+        EventRejected,
+        OldestEventDropped,
+        EventCoalesced
+    };
+    Q_ENUM(SubmitResult)
+
+    enum EventPriority {
+        NormalPriority,
+        HighPriority
+    };
+    Q_ENUM(EventPriority)
+
     static QScxmlStateMachine *fromFile(const QString &fileName);
     static QScxmlStateMachine *fromData(QIODevice *data, const QString &fileName = QString());
     QList<QScxmlError> parseErrors() const;
@@ -283,6 +317,7 @@ public:
     Q_INVOKABLE void submitEvent(QScxmlEvent *event);
     Q_INVOKABLE void submitEvent(const QString &eventName);
     Q_INVOKABLE void submitEvent(const QString &eventName, const QVariant &data);
+    Q_REVISION(6, 4) Q_INVOKABLE SubmitResult trySubmitEvent(QScxmlEvent *event);
     Q_INVOKABLE void cancelDelayedEvent(const QString &sendId);
 
     Q_INVOKABLE bool isDispatchableTarget(const QString &target) const;
@@ -294,6 +329,28 @@ public:
     void setTableData(QScxmlTableData *tableData);
     QBindable<QScxmlTableData*> bindableTableData();
 
+    bool isThreadedInvocation() const;
+    void setThreadedInvocation(bool threaded);
+    QBindable<bool> bindableThreadedInvocation();
+
+    int externalQueueCapacity() const;
+    void setExternalQueueCapacity(int capacity);
+    QBindable<int> bindableExternalQueueCapacity();
+
+    QueueOverflowPolicy queueOverflowPolicy() const;
+    void setQueueOverflowPolicy(QueueOverflowPolicy policy);
+    QBindable<QueueOverflowPolicy> bindableQueueOverflowPolicy();
+
+    bool isExternalQueueCongested() const;
+    QBindable<bool> bindableExternalQueueCongested() const;
+
+    void setEventPriority(const QString &eventDescriptor, EventPriority priority);
+    void setEventCoalescing(const QString &eventDescriptor, bool coalesce,
+                            const QString &keyField = QString());
+
+    bool saveSnapshot(QIODevice *device) const;
+    bool restoreSnapshot(QIODevice *device);
+
 Q_SIGNALS:
     void runningChanged(bool running);
     void invokedServicesChanged(const QList<QScxmlInvokableService *> &invokedServices);
@@ -305,6 +362,11 @@ Q_SIGNALS:
     void initializedChanged(bool initialized);
     void loaderChanged(QScxmlCompiler::Loader *loader);
     void tableDataChanged(QScxmlTableData *tableData);
+    Q_REVISION(6, 4) void threadedInvocationChanged(bool threadedInvocation);
+    Q_REVISION(6, 4) void externalQueueCapacityChanged(int capacity);
+    Q_REVISION(6, 4) void queueOverflowPolicyChanged(
+            QScxmlStateMachine::QueueOverflowPolicy policy);
+    Q_REVISION(6, 4) void externalQueueCongestedChanged(bool congested);
 
 public Q_SLOTS:
     void start();
@@ -319,6 +381,7 @@ protected: // methods for friends:
 
     // The methods below are used by the compiled state machines.
     bool isActive(int stateIndex) const;
+    void setStaticTables(const QScxmlTableData::StaticTables *tables);
 
 private:
     QMetaObject::Connection connectToStateImpl(const QString &scxmlStateName,
@@ -53,15 +53,28 @@
 
 #include <QtScxml/private/qscxmlexecutablecontent_p.h>
 #include <QtScxml/qscxmlstatemachine.h>
+#include <QtScxml/qscxmlcppdatamodel.h>
 #include <QtScxml/private/qscxmlstatemachineinfo_p.h>
 #include <QtCore/private/qobject_p.h>
 #include <QtCore/private/qmetaobject_p.h>
 #include <QtCore/private/qproperty_p.h>
+#include <QtCore/qatomic.h>
+#include <QtCore/qelapsedtimer.h>
 #include <QtCore/qmetaobject.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qvarlengtharray.h>
+#include <QtCore/qwaitcondition.h>
 #include "qscxmlglobals_p.h"
+#include "qscxmlclock_p.h"
+#include "qscxmleventlog_p.h"
+#include "qscxmltrace_p.h"
+
+#include <memory>
 
 QT_BEGIN_NAMESPACE
 
+class QDataStream;
+
 namespace QScxmlInternal {
 class EventLoopHook: public QObject
 {
@@ -119,6 +132,161 @@ Q_SIGNALS:
     void statesExited(const QList<QScxmlStateMachineInfo::StateId> &states);
     void transitionsTriggered(const QList<QScxmlStateMachineInfo::TransitionId> &transitions);
 };
+
+// Carries events to a state machine that lives on another thread than the sender. The events are
+// posted to the receiver on its own thread, in the order they were sent. Once the channel is
+// closed, events sent through it are dropped.
+//
+// If the receiver's external queue is bounded and blocks senders, the channel only delivers what
+// fits into the queue, and send() waits while as many events as fit are still pending. A channel
+// holding back events is stalled; the receiver resumes it once it has taken events from its queue.
+// Two state machines sending to each other could wait for each other forever, so a sender that
+// another thread is waiting for doesn't wait itself, and no sender waits longer than MaxSendWait.
+class EventChannel : public std::enable_shared_from_this<EventChannel>
+{
+    Q_DISABLE_COPY_MOVE(EventChannel)
+public:
+    enum { MaxSendWait = 5000 }; // ms
+
+    explicit EventChannel(QScxmlStateMachine *receiver);
+    ~EventChannel();
+
+    bool send(QScxmlEvent *event, QScxmlStateMachine *sender);
+    void close();
+    void resume();
+
+private:
+    void deliver();
+
+    QMutex m_mutex;
+    QWaitCondition m_space;
+    QScxmlStateMachine *m_receiver;
+    QList<QScxmlEvent *> m_pending;
+    int m_waitingSenders = 0; // counted in the receiver's m_waitingSenders, too
+    bool m_stalled = false; // only used on the receiver's thread
+};
+
+// The counters behind QScxmlStateMachineInfo::metrics(). They are counted up on the thread of the
+// state machine, but may be reset from any thread, so they are updated with atomic
+// read-modify-write operations rather than separate loads and stores. The per-state array is
+// replaced when the table data changes; stateMutex guards it against readers on other threads.
+struct Metrics
+{
+    typedef QAtomicInteger<quint64> Counter;
+    enum { MicrostepBuckets = 8 };
+
+    static void add(Counter &counter, quint64 value = 1)
+    { counter.fetchAndAddRelaxed(value); }
+
+    static void raise(QAtomicInt &highWater, int value)
+    {
+        int current = highWater.loadRelaxed();
+        while (value > current && !highWater.testAndSetRelaxed(current, value, current)) {}
+    }
+
+    // Bucket 0 counts macrosteps without microsteps, bucket i those with [2^(i-1), 2^i)
+    // microsteps, and the last bucket everything above.
+    static int bucket(quint64 microsteps)
+    {
+        int i = 0;
+        while (microsteps != 0 && i < MicrostepBuckets - 1) {
+            microsteps >>= 1;
+            ++i;
+        }
+        return i;
+    }
+
+    void finishMacrostep()
+    {
+        add(macrosteps);
+        add(microsteps, currentMicrosteps);
+        add(microstepsPerMacrostep[bucket(currentMicrosteps)]);
+        currentMicrosteps = 0;
+    }
+
+    void resize(int stateCount);
+    void reset();
+
+    Counter internalEvents;
+    Counter externalEvents;
+    Counter macrosteps;
+    Counter microsteps;
+    Counter microstepsPerMacrostep[MicrostepBuckets];
+    Counter guardEvaluations;
+    Counter guardRejections;
+    Counter guardErrors;
+    Counter externalEventsRejected;
+    Counter externalEventsDropped;
+    QAtomicInt internalQueueHighWater;
+    QAtomicInt externalQueueHighWater;
+    QAtomicInt delayedEventsPending;
+    QAtomicInt timingEnabled;
+    QMutex stateMutex; // not taken by the state machine's thread when counting
+    std::unique_ptr<Counter[]> executableContentTime; // nanoseconds, per state
+    int stateCount = 0;
+    quint64 currentMicrosteps = 0; // only used on the state machine's thread
+};
+
+// Per-state and per-transition statistics for QScxmlStateMachineInfo::profile(), indexed like the
+// state table. The arrays are allocated when profiling is enabled, so recording only increments
+// counters. Unlike the metrics, the profile is only accessed on the state machine's thread.
+struct Profile
+{
+    struct StateCounters
+    {
+        quint64 entries = 0;
+        qint64 dwellTime = 0; // nanoseconds
+        qint64 enteredAt = -1;
+    };
+
+    struct TransitionCounters
+    {
+        quint64 taken = 0;
+        quint64 rejected = 0;
+    };
+
+    void stateEntered(int stateIndex)
+    {
+        if (Q_UNLIKELY(enabled)) {
+            StateCounters &state = states[size_t(stateIndex)];
+            ++state.entries;
+            state.enteredAt = clock.nsecsElapsed();
+        }
+    }
+
+    void stateExited(int stateIndex)
+    {
+        if (Q_UNLIKELY(enabled)) {
+            StateCounters &state = states[size_t(stateIndex)];
+            if (state.enteredAt >= 0)
+                state.dwellTime += clock.nsecsElapsed() - state.enteredAt;
+            state.enteredAt = -1;
+        }
+    }
+
+    void transitionTaken(int transitionIndex)
+    {
+        if (Q_UNLIKELY(enabled))
+            ++transitions[size_t(transitionIndex)].taken;
+    }
+
+    void guardRejected(int transitionIndex)
+    {
+        if (Q_UNLIKELY(enabled))
+            ++transitions[size_t(transitionIndex)].rejected;
+    }
+
+    void enable(int stateCount, int transitionCount, const std::vector<int> &configuration);
+    void disable();
+    void reset(const std::vector<int> &configuration);
+
+    bool enabled = false;
+    QElapsedTimer clock;
+    std::vector<StateCounters> states;
+    std::vector<TransitionCounters> transitions;
+};
+
+struct Snapshot; // see qscxmlsnapshot.cpp
 } // QScxmlInternal namespace
 
 class QScxmlInvokableService;
@@ -195,8 +363,13 @@ public: // types
         bool isEmpty() const
         { return storage.empty(); }
 
-        void add(int i)
-        { if (!contains(i)) storage.push_back(i); }
+        bool add(int i)
+        {
+            if (contains(i))
+                return false;
+            storage.push_back(i);
+            return true;
+        }
 
         bool intersectsWith(const OrderedSet &other) const
         {
@@ -227,12 +400,24 @@ public: // types
         ~Queue()
         {  qDeleteAll(storage); }
 
+        void clear()
+        {
+            qDeleteAll(storage);
+            storage.clear();
+        }
+
         void enqueue(QScxmlEvent *e)
         { storage.append(e); }
 
         bool isEmpty() const
         { return storage.empty(); }
 
+        int size() const
+        { return int(storage.size()); }
+
+        const QList<QScxmlEvent *> &list() const
+        { return storage; }
+
         QScxmlEvent *dequeue()
         {
             Q_ASSERT(!isEmpty());
@@ -246,6 +431,108 @@ public: // types
         }
     };
 
+    // The external queue has a lane per QScxmlStateMachine::EventPriority, and events are taken
+    // from the highest priority lane that is not empty. An event with a coalescing key replaces
+    // the content of a pending event with the same key, which keeps its place in the queue.
+    class ExternalQueue
+    {
+        Queue lanes[QScxmlStateMachine::HighPriority + 1];
+        QHash<QString, QScxmlEvent *> pendingByKey;
+        QHash<const QScxmlEvent *, QString> keys;
+        int count = 0;
+
+        QScxmlEvent *take(Queue &lane)
+        {
+            QScxmlEvent *e = lane.dequeue();
+            --count;
+            if (Q_UNLIKELY(!keys.isEmpty())) {
+                const auto it = keys.constFind(e);
+                if (it != keys.constEnd()) {
+                    pendingByKey.remove(*it);
+                    keys.erase(it);
+                }
+            }
+            return e;
+        }
+
+    public:
+        void clear()
+        {
+            for (Queue &lane : lanes)
+                lane.clear();
+            pendingByKey.clear();
+            keys.clear();
+            count = 0;
+        }
+
+        bool isEmpty() const
+        { return count == 0; }
+
+        int size() const
+        { return count; }
+
+        bool hasPending(const QString &key) const
+        { return pendingByKey.contains(key); }
+
+        // Returns false if the event was coalesced into a pending one, and deleted.
+        bool enqueue(QScxmlEvent *e, QScxmlStateMachine::EventPriority priority,
+                     const QString &key)
+        {
+            if (!key.isEmpty()) {
+                const auto it = pendingByKey.constFind(key);
+                if (it != pendingByKey.constEnd()) {
+                    **it = *e;
+                    delete e;
+                    return false;
+                }
+                pendingByKey.insert(key, e);
+                keys.insert(e, key);
+            }
+            lanes[priority].enqueue(e);
+            ++count;
+            return true;
+        }
+
+        QScxmlEvent *dequeue()
+        {
+            Q_ASSERT(!isEmpty());
+            for (int i = QScxmlStateMachine::HighPriority; i > 0; --i) {
+                if (!lanes[i].isEmpty())
+                    return take(lanes[i]);
+            }
+            return take(lanes[QScxmlStateMachine::NormalPriority]);
+        }
+
+        // The oldest event of the lowest priority lane that is not empty.
+        QScxmlEvent *dequeueOldest()
+        {
+            Q_ASSERT(!isEmpty());
+            for (Queue &lane : lanes) {
+                if (!lane.isEmpty())
+                    return take(lane);
+            }
+            Q_UNREACHABLE();
+            return nullptr;
+        }
+
+        // In the order they would be dequeued.
+        QList<QScxmlEvent *> list() const
+        {
+            QList<QScxmlEvent *> result;
+            result.reserve(count);
+            for (int i = QScxmlStateMachine::HighPriority; i >= 0; --i)
+                result.append(lanes[i].list());
+            return result;
+        }
+    };
+
+    struct EventRule
+    {
+        QScxmlStateMachine::EventPriority priority = QScxmlStateMachine::NormalPriority;
+        bool coalesce = false;
+        QString keyField;
+    };
+
 public:
     QScxmlStateMachinePrivate(const QMetaObject *qMetaObject);
     ~QScxmlStateMachinePrivate();
@@ -262,13 +549,127 @@ public:
 
     void addService(int invokingState);
     void removeService(int invokingState);
+    void releaseService(QScxmlInvokableService *service);
+    void indexService(int id);
+    void unindexService(int id);
     QScxmlInvokableServiceFactory *serviceFactory(int id);
+    bool resetForReuse();
+    bool evaluateCondition(QScxmlExecutableContent::EvaluatorId id, bool *ok);
+    bool evaluateGuard(int transitionIndex, QScxmlExecutableContent::EvaluatorId condition);
 
+    // Binary tracing, see QScxmlInternal::Trace. Each call costs a single branch while tracing is
+    // off.
+    void trace(QScxmlInternal::TraceRecord::Type type, qint32 index = 0, qint32 value = 0)
+    {
+        if (Q_UNLIKELY(QScxmlInternal::Trace::isEnabled()))
+            QScxmlInternal::Trace::record(traceId(), type, index, value);
+    }
+    void traceEvent(const QScxmlEvent *event)
+    {
+        if (Q_UNLIKELY(QScxmlInternal::Trace::isEnabled())) {
+            QScxmlInternal::Trace::record(
+                        traceId(), QScxmlInternal::TraceRecord::EventTaken,
+                        qint32(QScxmlInternal::Trace::eventNameId(event->name())),
+                        event->eventType() == QScxmlEvent::InternalEvent ? 1 : 0);
+        }
+    }
+    quint32 traceId();
+
+    // Runs executable content on behalf of the state with the given index. The time spent is only
+    // measured if timing was enabled in the metrics, as reading the clock is not free.
+    bool execute(int stateIndex, QScxmlExecutableContent::ContainerId id,
+                 const QVariant &extraData = QVariant())
+    {
+        if (Q_LIKELY(!m_metrics.timingEnabled.loadRelaxed()))
+            return m_executionEngine->execute(id, extraData);
+        return executeTimed(stateIndex, id, extraData);
+    }
+    bool executeTimed(int stateIndex, QScxmlExecutableContent::ContainerId id,
+                      const QVariant &extraData);
+    void delayedEventsChanged()
+    { m_metrics.delayedEventsPending.storeRelaxed(int(m_delayedEvents.size())); }
+
+    // Access to the table data for the interpreter. State machines compiled by qscxmlc also pass
+    // their tables as plain arrays, which are read directly instead of through QScxmlTableData.
+    const QScxmlTableData::StaticTables *staticTables() const
+    { return m_staticTables; }
+
+    QString string(QScxmlExecutableContent::StringId id) const
+    {
+        if (!m_staticTables)
+            return m_tableData.value()->string(id);
+        if (id == QScxmlExecutableContent::NoString)
+            return QString();
+        Q_ASSERT(id >= 0 && id < m_staticTables->stringCount);
+        const uint offset = m_staticTables->stringOffsetsAndSizes[id * 2];
+        const uint size = m_staticTables->stringOffsetsAndSizes[id * 2 + 1];
+        return QString::fromRawData(
+                    reinterpret_cast<const QChar *>(m_staticTables->stringData + offset), size);
+    }
+
+    const QScxmlExecutableContent::InstructionId *instructions() const
+    {
+        return m_staticTables ? m_staticTables->instructions
+                              : m_tableData.value()->instructions();
+    }
+
+    QScxmlExecutableContent::EvaluatorInfo evaluatorInfo(
+            QScxmlExecutableContent::EvaluatorId id) const
+    {
+        if (!m_staticTables)
+            return m_tableData.value()->evaluatorInfo(id);
+        Q_ASSERT(id >= 0 && id < m_staticTables->evaluatorCount);
+        return m_staticTables->evaluators[id];
+    }
+
+    QScxmlExecutableContent::AssignmentInfo assignmentInfo(
+            QScxmlExecutableContent::EvaluatorId id) const
+    {
+        if (!m_staticTables)
+            return m_tableData.value()->assignmentInfo(id);
+        Q_ASSERT(id >= 0 && id < m_staticTables->assignmentCount);
+        return m_staticTables->assignments[id];
+    }
+
+    QScxmlExecutableContent::ForeachInfo foreachInfo(QScxmlExecutableContent::EvaluatorId id) const
+    {
+        if (!m_staticTables)
+            return m_tableData.value()->foreachInfo(id);
+        Q_ASSERT(id >= 0 && id < m_staticTables->foreachCount);
+        return m_staticTables->foreaches[id];
+    }
+
+    const QScxmlExecutableContent::StringId *dataNames(int *count) const
+    {
+        if (!m_staticTables)
+            return m_tableData.value()->dataNames(count);
+        *count = m_staticTables->dataNameCount;
+        return m_staticTables->dataNames;
+    }
+
+    bool setupDataModel();
     bool executeInitialSetup();
 
-    void routeEvent(QScxmlEvent *event);
-    void postEvent(QScxmlEvent *event);
+    QScxmlStateMachine::SubmitResult submitEvent(QScxmlEvent *event);
+    QScxmlStateMachine::SubmitResult routeEvent(QScxmlEvent *event);
+    QScxmlStateMachine::SubmitResult postEvent(QScxmlEvent *event);
+    QScxmlStateMachine::SubmitResult overflowExternalQueue(QScxmlEvent *event);
+    bool enqueueExternalEvent(QScxmlEvent *event);
+    const EventRule *eventRule(const QString &eventName) const;
+    QString coalescingKey(const QScxmlEvent *event, const EventRule *rule) const;
+    static QString eventRuleKey(const QString &eventDescriptor);
+    void setEventRule(const QString &key, const EventRule &rule);
+    void externalEventTaken();
+    void resumeStalledChannels();
+    void postServiceEvent(QScxmlEvent *event);
     void submitDelayedEvent(QScxmlEvent *event);
+    void fireDelayedEvent(size_t index);
+    void delayTimerFired(int timerId);
+    int startDelayTimer(int delay);
+    void killDelayTimer(int timerId);
+    int remainingDelay(int timerId) const;
+    void setClock(QScxmlInternal::Clock *clock);
+    void restartDelayTimers();
     void submitError(const QString &type, const QString &msg, const QString &sendid = QString());
 
     void start();
@@ -285,14 +686,35 @@ public:
     const OrderedSet &configuration() const { return m_configuration; }
 
     void updateMetaCache();
+    void updateHistoryCache();
+    void updateTransitionCache();
+
+    void moveToThread(QThread *thread);
+    void sendToParent(QScxmlEvent *event);
+
+    bool writeSnapshot(QDataStream &stream) const;
+    bool canRestore(const QScxmlInternal::Snapshot &snapshot) const;
+    bool restoreSnapshot(QScxmlInternal::Snapshot &snapshot);
 
 private:
     QStringList stateNames(const std::vector<int> &stateIndexes) const;
-    std::vector<int> historyStates(int stateIdx) const;
+    void recordHistory(int historyState);
+
+    struct HistoryValue {
+        const int *first = nullptr;
+        const int *last = nullptr;
+
+        bool isValid() const { return first != nullptr; }
+        const int *begin() const { return first; }
+        const int *end() const { return last; }
+    };
+    HistoryValue historyValue(int historyState) const;
 
     void exitInterpreter();
     void returnDoneEvent(QScxmlExecutableContent::ContainerId doneData);
     bool nameMatch(const StateTable::Array &patterns, QScxmlEvent *event) const;
+    void matchingDescriptors(const QString &eventName,
+                             QVarLengthArray<int, 8> *descriptors) const;
     void selectTransitions(OrderedSet &enabledTransitions,
                            const std::vector<int> &configInDocumentOrder,
                            QScxmlEvent *event) const;
@@ -367,33 +789,132 @@ public: // types & data fields:
     Q_OBJECT_COMPAT_PROPERTY_WITH_ARGS(QScxmlStateMachinePrivate, QScxmlTableData*, m_tableData,
                                        &QScxmlStateMachinePrivate::setTableData, nullptr);
 
+    void threadedInvocationChanged()
+    {
+        emit q_func()->threadedInvocationChanged(m_threadedInvocation.value());
+    }
+    Q_OBJECT_BINDABLE_PROPERTY(QScxmlStateMachinePrivate, bool, m_threadedInvocation,
+                               &QScxmlStateMachinePrivate::threadedInvocationChanged);
+
+    void externalQueueCapacityChanged()
+    {
+        queueLimitsChanged();
+        emit q_func()->externalQueueCapacityChanged(m_externalQueueCapacity.value());
+    }
+    Q_OBJECT_BINDABLE_PROPERTY_WITH_ARGS(QScxmlStateMachinePrivate, int, m_externalQueueCapacity, 0,
+                                         &QScxmlStateMachinePrivate::externalQueueCapacityChanged);
+
+    void queueOverflowPolicyChanged()
+    {
+        queueLimitsChanged();
+        emit q_func()->queueOverflowPolicyChanged(m_queueOverflowPolicy.value());
+    }
+    Q_OBJECT_BINDABLE_PROPERTY_WITH_ARGS(QScxmlStateMachinePrivate,
+                                         QScxmlStateMachine::QueueOverflowPolicy,
+                                         m_queueOverflowPolicy, QScxmlStateMachine::RejectEvent,
+                                         &QScxmlStateMachinePrivate::queueOverflowPolicyChanged);
+
+    void externalQueueCongestedChanged()
+    {
+        emit q_func()->externalQueueCongestedChanged(m_externalQueueCongested.value());
+    }
+    Q_OBJECT_BINDABLE_PROPERTY_WITH_ARGS(QScxmlStateMachinePrivate,
+                                         bool, m_externalQueueCongested, false,
+                                         &QScxmlStateMachinePrivate::externalQueueCongestedChanged);
+
+    void queueLimitsChanged();
+
+    // Copies of the capacity and the policy, cheap to check when posting and readable by the
+    // channels of senders on other threads. A limit of 0 means the queue is unbounded.
+    QAtomicInt m_externalQueueLimit;
+    QAtomicInt m_blockSenders;
+    QAtomicInt m_waitingSenders; // senders on other threads waiting for room in the queue
+    std::vector<std::shared_ptr<QScxmlInternal::EventChannel>> m_stalledChannels;
+
     bool m_isProcessingEvents;
     QScxmlCompilerPrivate::DefaultLoader m_defaultLoader;
     QScxmlExecutionEngine *m_executionEngine;
     const StateTable *m_stateTable;
     QScxmlStateMachine *m_parentStateMachine;
+    // Only set if this machine was invoked on a worker thread.
+    std::shared_ptr<QScxmlInternal::EventChannel> m_parentChannel;
+    std::shared_ptr<QScxmlInternal::EventChannel> m_inbox;
     QScxmlInternal::EventLoopHook m_eventLoopHook;
     typedef std::vector<std::pair<int, QScxmlEvent *>> DelayedQueue;
     DelayedQueue m_delayedEvents;
     const QMetaObject *m_metaObject;
     QScxmlInternal::ScxmlEventRouter m_router;
+    QScxmlInternal::Metrics m_metrics;
+    QScxmlInternal::Profile m_profile;
+    std::unique_ptr<QScxmlInternal::EventLogWriter> m_eventLog; // set while recording
+    bool m_replaying = false;
+    int m_virtualTimerId = 0; // the last timer id handed out while replaying
+    QScxmlInternal::Clock *m_clock = nullptr; // the event loop's timers are used if not set
 
 private:
     QScopedPointer<ParserData> m_parserData; // used when created by StateMachine::fromFile.
-    typedef QHash<int, QList<int>> HistoryValues;
+
+    // Everything needed to record a history state is computed when the table is set. The states a
+    // history state can record are descendants of its parent, which form the contiguous index
+    // range [firstCandidate, lastCandidate] as the table is in document order. The recorded
+    // states go to m_historyStorage[offset, offset + count), where count is -1 until the parent
+    // is exited for the first time.
+    struct HistoryRecord {
+        int parent;
+        int firstCandidate;
+        int lastCandidate;
+        int offset;
+        int capacity;
+        int count;
+        bool deep;
+    };
     struct InvokedService {
         int invokingState;
         QScxmlInvokableService *service;
         QString serviceName;
+        QString serviceId;
     };
 
     // TODO: move the stuff below to a struct that can be reset
-    HistoryValues m_historyValue;
+    std::vector<int> m_historyChildOffsets; // history children of state s are in
+    std::vector<int> m_historyChildren;     // [offsets[s], offsets[s + 1])
+    std::vector<int> m_historyRecordIndex;  // state -> m_historyRecords index, or -1
+    std::vector<HistoryRecord> m_historyRecords;
+    std::vector<int> m_historyStorage;
+    // Whether a state has eventless transitions itself, and whether it or one of its ancestors
+    // has. The number of active states with eventless transitions is kept up to date, so that
+    // eventless transitions are only looked for if there can be any.
+    std::vector<char> m_hasEventlessTransitions;
+    std::vector<char> m_eventlessInAncestry;
+    int m_activeEventlessStates = 0;
+    // Transitions with events of state s are in [offsets[s], offsets[s + 1]), sorted by the
+    // interned event descriptor and then by their position in the state's transitions, so that
+    // only the transitions matching an event's name need to be looked at.
+    struct EventTransition {
+        int descriptor; // WildcardDescriptor for "*"
+        int position;   // in the transitions of the source state
+    };
+    enum { WildcardDescriptor = -1 };
+    QHash<QString, int> m_eventDescriptors; // descriptor without ".*" suffix -> id
+    std::vector<int> m_eventTransitionOffsets;
+    std::vector<EventTransition> m_eventTransitions;
     OrderedSet m_configuration;
     Queue m_internalQueue;
-    Queue m_externalQueue;
+    ExternalQueue m_externalQueue;
+    QHash<QString, EventRule> m_eventRules; // by eventRuleKey()
     QSet<int> m_statesToInvoke;
     std::vector<InvokedService> m_invokedServices;
+    // Running services by their id, and the running services that get all events forwarded, as
+    // indexes into m_invokedServices. This way routing an event does not need to look at every
+    // service.
+    QMultiHash<QString, int> m_invokedServiceIds;
+    std::vector<int> m_autoforwardServices; // sorted
+    // The evaluators generated for a C++ data model, so that transition conditions can be called
+    // directly instead of through QScxmlDataModel::evaluateToBool(). Set up in init().
+    QScxmlCppDataModel *m_cppDataModel = nullptr;
+    const QScxmlCppDataModel::EvaluatorTable *m_cppEvaluators = nullptr;
+    const QScxmlTableData::StaticTables *m_staticTables = nullptr;
+    quint32 m_traceId = 0; // registered on the first trace record
     QList<QScxmlInvokableService*> invokedServicesActualCalculation() const
     {
         QList<QScxmlInvokableService *> result;
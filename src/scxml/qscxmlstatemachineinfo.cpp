@@ -41,6 +41,8 @@
 #include "qscxmlstatemachine_p.h"
 #include "qscxmlexecutablecontent_p.h"
 
+#include <QtCore/qjsonarray.h>
+
 QT_BEGIN_NAMESPACE
 
 class QScxmlStateMachineInfoPrivate: public QObjectPrivate
@@ -102,7 +104,7 @@ QString QScxmlStateMachineInfo::stateName(int stateId) const
 
     auto state = d->stateTable()->state(stateId);
     if (state.name >= 0)
-        return d->stateMachinePrivate()->m_tableData->string(state.name);
+        return d->stateMachinePrivate()->string(state.name);
     else
         return QString();
 }
@@ -233,7 +235,7 @@ QList<QString> QScxmlStateMachineInfo::transitionEvents(TransitionId transitionI
     auto eventIds = d->stateTable()->array(transition.events);
     events.reserve(eventIds.size());
     for (auto eventId : eventIds) {
-        events.append(d->stateMachinePrivate()->m_tableData->string(eventId));
+        events.append(d->stateMachinePrivate()->string(eventId));
     }
 
     return events;
@@ -246,4 +248,140 @@ QList<QScxmlStateMachineInfo::StateId> QScxmlStateMachineInfo::configuration() c
     return QList<StateId>(list.cbegin(), list.cend());
 }
 
+// Takes a snapshot of the counters the state machine keeps while running. The histogram of
+// microsteps per macrostep has a bucket for macrosteps without microsteps, followed by buckets for
+// 1, 2-3, 4-7, ... microsteps, the last one being open-ended. The time spent in executable content
+// is given in nanoseconds per state, and is only measured while timing is enabled. This can be
+// called from any thread; the counters are read one by one, so they need not be consistent with
+// each other while the state machine is running.
+QScxmlStateMachineInfo::Metrics QScxmlStateMachineInfo::metrics() const
+{
+    Q_D(const QScxmlStateMachineInfo);
+    QScxmlInternal::Metrics &counters = d->stateMachinePrivate()->m_metrics;
+
+    Metrics result;
+    result.internalEventsProcessed = counters.internalEvents.loadRelaxed();
+    result.externalEventsProcessed = counters.externalEvents.loadRelaxed();
+    result.macrosteps = counters.macrosteps.loadRelaxed();
+    result.microsteps = counters.microsteps.loadRelaxed();
+    result.microstepsPerMacrostep.reserve(QScxmlInternal::Metrics::MicrostepBuckets);
+    for (const auto &bucket : counters.microstepsPerMacrostep)
+        result.microstepsPerMacrostep.append(bucket.loadRelaxed());
+    result.internalQueueHighWater = counters.internalQueueHighWater.loadRelaxed();
+    result.externalQueueHighWater = counters.externalQueueHighWater.loadRelaxed();
+    result.externalEventsRejected = counters.externalEventsRejected.loadRelaxed();
+    result.externalEventsDropped = counters.externalEventsDropped.loadRelaxed();
+    result.delayedEventsPending = counters.delayedEventsPending.loadRelaxed();
+    result.guardEvaluations = counters.guardEvaluations.loadRelaxed();
+    result.guardRejections = counters.guardRejections.loadRelaxed();
+    result.guardErrors = counters.guardErrors.loadRelaxed();
+    QMutexLocker locker(&counters.stateMutex);
+    result.executableContentTime.reserve(counters.stateCount);
+    for (int i = 0; i < counters.stateCount; ++i)
+        result.executableContentTime.append(counters.executableContentTime[i].loadRelaxed());
+    return result;
+}
+
+// Sets all counters back to zero. The number of pending delayed events is a current value rather
+// than a counter, and is kept. This can be called from any thread; no counts are lost, but a
+// macrostep in progress may be partly counted before and partly after the reset.
+void QScxmlStateMachineInfo::resetMetrics()
+{
+    Q_D(QScxmlStateMachineInfo);
+    d->stateMachinePrivate()->m_metrics.reset();
+}
+
+bool QScxmlStateMachineInfo::isTimingEnabled() const
+{
+    Q_D(const QScxmlStateMachineInfo);
+    return d->stateMachinePrivate()->m_metrics.timingEnabled.loadRelaxed();
+}
+
+void QScxmlStateMachineInfo::setTimingEnabled(bool enabled)
+{
+    Q_D(QScxmlStateMachineInfo);
+    d->stateMachinePrivate()->m_metrics.timingEnabled.storeRelaxed(enabled ? 1 : 0);
+}
+
+// Returns what was recorded since profiling was enabled or last reset, as a JSON object with a
+// "states" and a "transitions" array, indexed by StateId and TransitionId. Each state has its
+// number of "entries" and its "dwellTime" in nanoseconds, which includes the time since the state
+// was last entered if it is still active. Each transition has the number of times it was "taken",
+// and the number of times its guard "rejected" it. Names, sources and targets are included so
+// that tools can lay the numbers over the chart without access to the state machine.
+QJsonObject QScxmlStateMachineInfo::profile() const
+{
+    Q_D(const QScxmlStateMachineInfo);
+    const QScxmlInternal::Profile &counters = d->stateMachinePrivate()->m_profile;
+
+    QJsonObject result;
+    result.insert(QStringLiteral("name"), stateMachine()->name());
+    if (!counters.enabled)
+        return result;
+
+    const qint64 now = counters.clock.nsecsElapsed();
+    QJsonArray states;
+    for (size_t i = 0, ei = counters.states.size(); i != ei; ++i) {
+        const auto &state = counters.states[i];
+        qint64 dwellTime = state.dwellTime;
+        if (state.enteredAt >= 0)
+            dwellTime += now - state.enteredAt;
+        QJsonObject entry;
+        entry.insert(QStringLiteral("name"), stateName(int(i)));
+        entry.insert(QStringLiteral("entries"), qint64(state.entries));
+        entry.insert(QStringLiteral("dwellTime"), dwellTime);
+        entry.insert(QStringLiteral("active"), state.enteredAt >= 0);
+        states.append(entry);
+    }
+    result.insert(QStringLiteral("states"), states);
+
+    QJsonArray transitions;
+    for (size_t i = 0, ei = counters.transitions.size(); i != ei; ++i) {
+        const auto &transition = counters.transitions[i];
+        QJsonArray targets;
+        for (StateId target : transitionTargets(int(i)))
+            targets.append(target);
+        QJsonObject entry;
+        entry.insert(QStringLiteral("source"), transitionSource(int(i)));
+        entry.insert(QStringLiteral("targets"), targets);
+        entry.insert(QStringLiteral("events"), QJsonArray::fromStringList(transitionEvents(int(i))));
+        entry.insert(QStringLiteral("taken"), qint64(transition.taken));
+        entry.insert(QStringLiteral("rejected"), qint64(transition.rejected));
+        transitions.append(entry);
+    }
+    result.insert(QStringLiteral("transitions"), transitions);
+    return result;
+}
+
+void QScxmlStateMachineInfo::resetProfile()
+{
+    Q_D(QScxmlStateMachineInfo);
+    auto smp = d->stateMachinePrivate();
+    smp->m_profile.reset(smp->configuration().list());
+}
+
+bool QScxmlStateMachineInfo::isProfilingEnabled() const
+{
+    Q_D(const QScxmlStateMachineInfo);
+    return d->stateMachinePrivate()->m_profile.enabled;
+}
+
+// Profiling records entries, dwell times, taken transitions and guard rejections. Enabling it
+// allocates the counters for the current state table; disabling it discards them.
+void QScxmlStateMachineInfo::setProfilingEnabled(bool enabled)
+{
+    Q_D(QScxmlStateMachineInfo);
+    auto smp = d->stateMachinePrivate();
+    if (enabled == smp->m_profile.enabled)
+        return;
+    if (!enabled) {
+        smp->m_profile.disable();
+        return;
+    }
+    if (!smp->m_tableData.value())
+        return;
+    smp->m_profile.enable(d->stateTable()->stateCount, d->stateTable()->transitionCount,
+                          smp->configuration().list());
+}
+
 QT_END_NAMESPACE
@@ -52,6 +52,8 @@
 //
 
 #include <QtScxml/qscxmlglobals.h>
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qlist.h>
 #include <QtCore/qobject.h>
 #include <QtCore/private/qglobal_p.h>
 
@@ -87,6 +89,24 @@ public: // types
         SyntheticTransition = 2
     };
 
+    struct Metrics
+    {
+        quint64 internalEventsProcessed = 0;
+        quint64 externalEventsProcessed = 0;
+        quint64 macrosteps = 0;
+        quint64 microsteps = 0;
+        QList<quint64> microstepsPerMacrostep;
+        int internalQueueHighWater = 0;
+        int externalQueueHighWater = 0;
+        quint64 externalEventsRejected = 0;
+        quint64 externalEventsDropped = 0;
+        int delayedEventsPending = 0;
+        quint64 guardEvaluations = 0;
+        quint64 guardRejections = 0;
+        quint64 guardErrors = 0;
+        QList<quint64> executableContentTime;
+    };
+
 public: // methods
     QScxmlStateMachineInfo(QScxmlStateMachine *stateMachine);
 
@@ -105,6 +125,16 @@ public: // methods
     QList<QString> transitionEvents(TransitionId transitionId) const;
     QList<StateId> configuration() const;
 
+    Metrics metrics() const;
+    void resetMetrics();
+    bool isTimingEnabled() const;
+    void setTimingEnabled(bool enabled);
+
+    QJsonObject profile() const;
+    void resetProfile();
+    bool isProfilingEnabled() const;
+    void setProfilingEnabled(bool enabled);
+
 Q_SIGNALS:
     void statesEntered(const QList<QScxmlStateMachineInfo::StateId> &states);
     void statesExited(const QList<QScxmlStateMachineInfo::StateId> &states);
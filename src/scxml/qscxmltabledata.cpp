@@ -106,6 +106,18 @@ QT_USE_NAMESPACE
     sequence of integers.
  */
 
+/*!
+    \class QScxmlTableData::StaticTables
+    \since 6.4
+    \inmodule QtScxml
+    \brief The StaticTables struct holds the tables of a compiled state machine as plain arrays.
+
+    State machines compiled by the Qt SCXML compiler keep their strings, instructions,
+    evaluators, assignments, foreach loops, data names, and state table in static arrays. They pass pointers to those arrays to the
+    state machine, which then reads them directly instead of calling the virtual methods of
+    QScxmlTableData. The strings are stored as UTF-16 data with pairs of offset and size.
+ */
+
 /*!
     \fn QScxmlTableData::serviceFactory(int id) const
     Returns the service factory that creates invokable services for the state
@@ -338,6 +350,7 @@ protected: // visitor
                     finalize = startNewSequence();
                     visit(&invoke->finalize);
                     endSequence();
+                    finalize = m_instructions.deduplicate(finalize);
                 }
                 auto srcexpr = createEvaluatorString(QStringLiteral("invoke"),
                                                      QStringLiteral("srcexpr"),
@@ -411,9 +424,10 @@ protected: // visitor
 
         if (!transition->instructionsOnTransition.isEmpty()) {
             m_currentTransition = transitionIndex;
-            newTransition.transitionInstructions = startNewSequence();
+            const ContainerId instructions = startNewSequence();
             visit(&transition->instructionsOnTransition);
             endSequence();
+            newTransition.transitionInstructions = m_instructions.deduplicate(instructions);
             m_currentTransition = -1;
         }
 
@@ -602,7 +616,7 @@ protected:
         auto id = m_instructions.newContainerId();
         auto outSequences = m_instructions.add<InstructionSequences>();
         generate(outSequences, inSequences);
-        return id;
+        return m_instructions.deduplicate(id);
     }
 
     void generate(Array<ParameterInfo> *out, const QList<DocumentModel::Param *> &in)
@@ -683,9 +697,8 @@ protected:
     {
         if (!expr.isEmpty()) {
             if (isCppDataModel()) {
-                auto id = m_evaluators.add(EvaluatorInfo(), false);
-                m_dataModelInfo.stringEvaluators.insert(id, expr);
-                return id;
+                return addCppEvaluator(&m_dataModelInfo.stringEvaluators, &m_stringEvaluatorIds,
+                                       expr);
             } else {
                 return addEvaluator(expr, createContext(instrName, attrName, expr));
             }
@@ -699,9 +712,8 @@ protected:
     {
         if (!cond.isEmpty()) {
             if (isCppDataModel()) {
-                auto id = m_evaluators.add(EvaluatorInfo(), false);
-                m_dataModelInfo.boolEvaluators.insert(id, cond);
-                return id;
+                return addCppEvaluator(&m_dataModelInfo.boolEvaluators, &m_boolEvaluatorIds,
+                                       cond);
             } else {
                 return addEvaluator(cond, createContext(instrName, attrName, cond));
             }
@@ -715,9 +727,8 @@ protected:
     {
         if (!expr.isEmpty()) {
             if (isCppDataModel()) {
-                auto id = m_evaluators.add(EvaluatorInfo(), false);
-                m_dataModelInfo.variantEvaluators.insert(id, expr);
-                return id;
+                return addCppEvaluator(&m_dataModelInfo.variantEvaluators, &m_variantEvaluatorIds,
+                                       expr);
             } else {
                 return addEvaluator(expr, createContext(instrName, attrName, expr));
             }
@@ -731,9 +742,8 @@ protected:
     {
         if (!stuff.isEmpty()) {
             if (isCppDataModel()) {
-                auto id = m_evaluators.add(EvaluatorInfo(), false);
-                m_dataModelInfo.voidEvaluators.insert(id, stuff);
-                return id;
+                return addCppEvaluator(&m_dataModelInfo.voidEvaluators, &m_voidEvaluatorIds,
+                                       stuff);
             } else {
                 return addEvaluator(stuff, createContext(instrName, attrName, stuff));
             }
@@ -773,10 +783,15 @@ protected:
         if (array.isEmpty())
             return -1;
 
-        const int res = m_arrays.size();
-        m_arrays.push_back(array.size());
-        m_arrays.append(array);
-        return res;
+        // Arrays are immutable, so states and transitions with the same targets, events or
+        // children can share one.
+        int &res = m_arrayOffsets[array];
+        if (res == 0) {
+            res = m_arrays.size() + 1;
+            m_arrays.push_back(array.size());
+            m_arrays.append(array);
+        }
+        return res - 1;
     }
 
     int currentParent() const
@@ -818,6 +833,21 @@ protected:
         return QStringLiteral("%1 with %2=\"%3\"").arg(location, attrName, attrValue);
     }
 
+    // The C++ data model has no use for the context, so identical expressions share one
+    // evaluator, and qscxmlc generates only one case for them.
+    EvaluatorId addCppEvaluator(QHash<EvaluatorId, QString> *evaluators,
+                                QHash<QString, EvaluatorId> *ids, const QString &expr)
+    {
+        const auto it = ids->constFind(expr);
+        if (it != ids->constEnd())
+            return *it;
+
+        const EvaluatorId id = m_evaluators.add(EvaluatorInfo(), false);
+        evaluators->insert(id, expr);
+        ids->insert(expr, id);
+        return id;
+    }
+
     EvaluatorId addEvaluator(const QString &expr, const QString &context)
     {
         EvaluatorInfo ei;
@@ -931,9 +961,26 @@ private:
             m_info = info;
         }
 
+        // Returns the id of an earlier container with the same contents as the one starting at
+        // id, and drops the latter. Instructions don't refer to each other by offset, so
+        // top-level containers can be shared.
+        ContainerId deduplicate(ContainerId id)
+        {
+            Q_ASSERT(m_info == nullptr);
+            const QList<qint32> contents = m_instr.mid(id);
+            const ContainerId existing = m_containers.value(contents, NoContainer);
+            if (existing == NoContainer) {
+                m_containers.insert(contents, id);
+                return id;
+            }
+            m_instr.resize(id);
+            return existing;
+        }
+
     private:
         QList<qint32> &m_instr;
         SequenceInfo *m_info;
+        QHash<QList<qint32>, ContainerId> m_containers;
     };
 
     QList<SequenceInfo> m_activeSequences;
@@ -946,12 +993,17 @@ private:
     Table<QList<EvaluatorInfo>, EvaluatorInfo, EvaluatorId> m_evaluators;
     Table<QList<AssignmentInfo>, AssignmentInfo, EvaluatorId> m_assignments;
     Table<QList<ForeachInfo>, ForeachInfo, EvaluatorId> m_foreaches;
+    QHash<QString, EvaluatorId> m_stringEvaluatorIds;
+    QHash<QString, EvaluatorId> m_boolEvaluatorIds;
+    QHash<QString, EvaluatorId> m_variantEvaluatorIds;
+    QHash<QString, EvaluatorId> m_voidEvaluatorIds;
     QList<StringId> &m_dataIds;
     bool m_isCppDataModel = false;
 
     StateTable m_stateTable;
     QList<int> m_parents;
     QList<qint32> m_arrays;
+    QHash<QList<int>, int> m_arrayOffsets; // offset + 1, so that 0 means "not added yet"
 
     QList<StateTable::Transition> m_allTransitions;
     QHash<DocumentModel::Transition *, int> m_docTransitionIndices;
@@ -44,7 +44,7 @@
 #include <QtCore/qstring.h>
 
 #ifndef Q_QSCXMLC_OUTPUT_REVISION
-#define Q_QSCXMLC_OUTPUT_REVISION 2
+#define Q_QSCXMLC_OUTPUT_REVISION 3
 #endif
 
 QT_BEGIN_NAMESPACE
@@ -56,6 +56,23 @@ class Q_SCXML_EXPORT QScxmlTableData
 public:
     virtual ~QScxmlTableData();
 
+    struct StaticTables
+    {
+        const QScxmlExecutableContent::InstructionId *instructions;
+        const QScxmlExecutableContent::EvaluatorInfo *evaluators;
+        int evaluatorCount;
+        const QScxmlExecutableContent::AssignmentInfo *assignments;
+        int assignmentCount;
+        const QScxmlExecutableContent::ForeachInfo *foreaches;
+        int foreachCount;
+        const QScxmlExecutableContent::StringId *dataNames;
+        int dataNameCount;
+        const qint32 *stateMachineTable;
+        const uint *stringOffsetsAndSizes;
+        const char16_t *stringData;
+        int stringCount;
+    };
+
     virtual QString string(QScxmlExecutableContent::StringId id) const = 0;
     virtual QScxmlExecutableContent::InstructionId *instructions() const = 0;
     virtual QScxmlExecutableContent::EvaluatorInfo evaluatorInfo(QScxmlExecutableContent::EvaluatorId evaluatorId) const = 0;
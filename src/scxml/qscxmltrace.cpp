@@ -0,0 +1,381 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtScxml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qscxmltrace_p.h"
+
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qiodevice.h>
+#include <QtCore/qmutex.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace QScxmlInternal {
+
+namespace {
+
+struct TraceBuffer
+{
+    int thread;
+    // Only the owning thread writes head. clear() moves start up to head instead of resetting
+    // head, so that it doesn't race with record(). start is guarded by the registry mutex.
+    QAtomicInteger<quintptr> head; // number of records written, including overwritten ones
+    quintptr start;
+    TraceRecord records[Trace::BufferSize];
+};
+
+struct MachineInfo
+{
+    QString name;
+    QString sessionId;
+    QStringList states;
+    QStringList transitions;
+};
+
+struct TraceRegistry
+{
+    QMutex mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    std::vector<TraceBuffer *> freeBuffers; // of threads that have exited
+    QHash<QString, quint32> eventIds;
+    QStringList eventNames; // by id - 1
+    QList<MachineInfo> machines; // by id - 1
+    QElapsedTimer clock;
+    QString fileName; // written to when the application exits, if set
+};
+
+Q_GLOBAL_STATIC(TraceRegistry, traceRegistry)
+
+TraceBuffer *acquireBuffer()
+{
+    TraceRegistry *registry = traceRegistry();
+    QMutexLocker locker(&registry->mutex);
+    if (!registry->freeBuffers.empty()) {
+        // The records of the previous thread are kept, and show up on the same track.
+        TraceBuffer *buffer = registry->freeBuffers.back();
+        registry->freeBuffers.pop_back();
+        return buffer;
+    }
+    registry->buffers.push_back(std::make_unique<TraceBuffer>());
+    TraceBuffer *buffer = registry->buffers.back().get();
+    buffer->thread = int(registry->buffers.size());
+    buffer->start = 0;
+    return buffer;
+}
+
+void releaseBuffer(TraceBuffer *buffer)
+{
+    if (traceRegistry.isDestroyed())
+        return;
+    TraceRegistry *registry = traceRegistry();
+    QMutexLocker locker(&registry->mutex);
+    registry->freeBuffers.push_back(buffer);
+}
+
+// Hands the buffer back when the thread exits, so that short-lived threads don't each leave one
+// behind.
+struct CurrentBuffer
+{
+    ~CurrentBuffer()
+    {
+        if (buffer)
+            releaseBuffer(buffer);
+    }
+
+    TraceBuffer *buffer = nullptr;
+};
+
+thread_local CurrentBuffer currentBuffer;
+
+QByteArray quoted(const QString &string)
+{
+    QByteArray result;
+    result.reserve(string.size() + 2);
+    result += '"';
+    for (char c : string.toUtf8()) {
+        switch (c) {
+        case '"':
+            result += "\\\"";
+            break;
+        case '\\':
+            result += "\\\\";
+            break;
+        default:
+            if (uchar(c) < 0x20)
+                result += "\\u00" + QByteArray::number(uchar(c), 16).rightJustified(2, '0');
+            else
+                result += c;
+        }
+    }
+    result += '"';
+    return result;
+}
+
+QString lookup(const QStringList &names, qint32 index)
+{
+    return index >= 0 && index < names.size() ? names.at(index) : QString::number(index);
+}
+
+bool writeChromeTrace(TraceRegistry *registry, QIODevice *device)
+{
+    struct Entry
+    {
+        TraceRecord record;
+        int thread;
+    };
+
+    std::vector<Entry> entries;
+    QList<MachineInfo> machines;
+    QStringList eventNames;
+    {
+        QMutexLocker locker(&registry->mutex);
+        for (const auto &buffer : registry->buffers) {
+            // The oldest slot is skipped, as it is the one the next record() overwrites.
+            const quintptr head = buffer->head.loadAcquire();
+            const quintptr count = std::min<quintptr>(head - buffer->start,
+                                                      Trace::BufferSize - 1);
+            for (quintptr i = head - count; i != head; ++i)
+                entries.push_back({ buffer->records[i % Trace::BufferSize], buffer->thread });
+        }
+        machines = registry->machines;
+        eventNames = registry->eventNames;
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.record.timestamp < b.record.timestamp;
+    });
+
+    QByteArray out = "{\"traceEvents\":[\n";
+    for (qsizetype i = 0, ei = machines.size(); i != ei; ++i) {
+        const MachineInfo &machine = machines.at(i);
+        out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + QByteArray::number(i + 1)
+                + ",\"args\":{\"name\":"
+                + quoted(machine.name + QLatin1String(" (") + machine.sessionId
+                         + QLatin1Char(')'))
+                + "}},\n";
+    }
+
+    for (const Entry &entry : entries) {
+        const TraceRecord &record = entry.record;
+        const qsizetype machineIndex = qsizetype(record.machine) - 1;
+        if (machineIndex < 0 || machineIndex >= machines.size())
+            continue;
+        const MachineInfo &machine = machines.at(machineIndex);
+
+        QByteArray name;
+        QByteArray fields;
+        quint64 timestamp = record.timestamp;
+        switch (record.type) {
+        case TraceRecord::MacrostepBegin:
+        case TraceRecord::MacrostepEnd:
+            name = quoted(QStringLiteral("macrostep"));
+            fields = record.type == TraceRecord::MacrostepBegin ? "\"ph\":\"B\"" : "\"ph\":\"E\"";
+            break;
+        case TraceRecord::MicrostepBegin:
+            name = quoted(QStringLiteral("microstep"));
+            fields = "\"ph\":\"B\",\"args\":{\"transitions\":" + QByteArray::number(record.value)
+                    + '}';
+            break;
+        case TraceRecord::MicrostepEnd:
+            name = quoted(QStringLiteral("microstep"));
+            fields = "\"ph\":\"E\"";
+            break;
+        case TraceRecord::EventTaken:
+            name = quoted(record.index > 0 && record.index <= eventNames.size()
+                          ? eventNames.at(record.index - 1) : QString());
+            fields = "\"cat\":\"event\",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"internal\":"
+                    + QByteArray(record.value ? "true" : "false") + '}';
+            break;
+        case TraceRecord::TransitionTaken:
+            name = quoted(lookup(machine.transitions, record.index));
+            fields = "\"cat\":\"transition\",\"ph\":\"i\",\"s\":\"t\"";
+            break;
+        case TraceRecord::StateEntered:
+        case TraceRecord::StateExited:
+            name = quoted(lookup(machine.states, record.index));
+            fields = "\"cat\":\"state\",\"ph\":\""
+                    + QByteArray(record.type == TraceRecord::StateEntered ? "b" : "e")
+                    + "\",\"id\":\"" + QByteArray::number(record.machine) + ':'
+                    + QByteArray::number(record.index) + '"';
+            break;
+        case TraceRecord::GuardEvaluated:
+            name = quoted(QStringLiteral("guard"));
+            timestamp -= quint64(record.value);
+            fields = "\"cat\":\"guard\",\"ph\":\"X\",\"dur\":"
+                    + QByteArray::number(record.value / 1000.0, 'f', 3)
+                    + ",\"args\":{\"transition\":" + quoted(lookup(machine.transitions,
+                                                                   record.index))
+                    + ",\"result\":" + QByteArray(record.flag ? "true" : "false") + '}';
+            break;
+        }
+
+        out += "{\"name\":" + name + ',' + fields
+                + ",\"pid\":" + QByteArray::number(record.machine)
+                + ",\"tid\":" + QByteArray::number(entry.thread)
+                + ",\"ts\":" + QByteArray::number(timestamp / 1000.0, 'f', 3) + "},\n";
+    }
+    out.chop(2); // trailing ",\n", or "\n" if there is nothing
+    out += "\n]}\n";
+    return device->write(out) == out.size();
+}
+
+void writeTraceFile()
+{
+    const QString fileName = traceRegistry()->fileName;
+    if (!Trace::writeChromeTrace(fileName))
+        qWarning("Cannot write the SCXML trace to %s", qPrintable(fileName));
+}
+
+void initializeTrace()
+{
+    const QString fileName = qEnvironmentVariable("QT_SCXML_TRACE");
+    if (fileName.isEmpty())
+        return;
+    traceRegistry()->fileName = fileName;
+    qAddPostRoutine(writeTraceFile);
+    Trace::setEnabled(true);
+}
+
+} // anonymous namespace
+
+Q_CONSTRUCTOR_FUNCTION(initializeTrace)
+
+QBasicAtomicInt Trace::enabled = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+void Trace::setEnabled(bool on)
+{
+    if (on) {
+        TraceRegistry *registry = traceRegistry();
+        QMutexLocker locker(&registry->mutex);
+        if (!registry->clock.isValid())
+            registry->clock.start();
+    }
+    enabled.storeRelaxed(on ? 1 : 0);
+}
+
+// Drops the recorded traces. The names of machines and events are kept, as they are cached.
+void Trace::clear()
+{
+    TraceRegistry *registry = traceRegistry();
+    QMutexLocker locker(&registry->mutex);
+    for (const auto &buffer : registry->buffers)
+        buffer->start = buffer->head.loadAcquire();
+}
+
+quint32 Trace::registerMachine(const QString &name, const QString &sessionId,
+                               const QStringList &states, const QStringList &transitions)
+{
+    TraceRegistry *registry = traceRegistry();
+    QMutexLocker locker(&registry->mutex);
+    registry->machines.append({ name, sessionId, states, transitions });
+    return quint32(registry->machines.size());
+}
+
+// Event names are interned for the lifetime of the process. done.invoke.<invokeid> names a single
+// invocation, and generated invoke ids are unique per session, so only "done.invoke" is kept for
+// those. Past MaxEventNames distinct names, further ones are recorded without a name.
+quint32 Trace::eventNameId(const QString &name)
+{
+    static const QString doneInvoke = QStringLiteral("done.invoke");
+    const QString &key = name.size() > doneInvoke.size() && name.startsWith(doneInvoke)
+            && name.at(doneInvoke.size()) == QLatin1Char('.') ? doneInvoke : name;
+
+    thread_local QHash<QString, quint32> cache;
+    const auto it = cache.constFind(key);
+    if (it != cache.constEnd())
+        return *it;
+
+    TraceRegistry *registry = traceRegistry();
+    QMutexLocker locker(&registry->mutex);
+    quint32 id = registry->eventIds.value(key);
+    if (id == 0) {
+        if (registry->eventNames.size() >= MaxEventNames)
+            return 0;
+        registry->eventNames.append(key);
+        id = quint32(registry->eventNames.size());
+        registry->eventIds.insert(key, id);
+    }
+    cache.insert(key, id);
+    return id;
+}
+
+quint64 Trace::timestamp()
+{
+    return quint64(traceRegistry()->clock.nsecsElapsed());
+}
+
+void Trace::record(quint32 machine, TraceRecord::Type type, qint32 index, qint32 value,
+                   quint8 flag)
+{
+    TraceBuffer *buffer = currentBuffer.buffer;
+    if (Q_UNLIKELY(!buffer))
+        buffer = currentBuffer.buffer = acquireBuffer();
+
+    // Only this thread writes to the buffer. Readers see the record once head has moved past it.
+    const quintptr head = buffer->head.loadRelaxed();
+    TraceRecord &record = buffer->records[head % BufferSize];
+    record.timestamp = timestamp();
+    record.machine = machine;
+    record.type = type;
+    record.flag = flag;
+    record.reserved = 0;
+    record.index = index;
+    record.value = value;
+    buffer->head.storeRelease(head + 1);
+}
+
+bool Trace::writeChromeTrace(QIODevice *device)
+{
+    return QScxmlInternal::writeChromeTrace(traceRegistry(), device);
+}
+
+bool Trace::writeChromeTrace(const QString &fileName)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate) && writeChromeTrace(&file);
+}
+
+} // QScxmlInternal namespace
+
+QT_END_NAMESPACE
@@ -0,0 +1,131 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtScxml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QSCXMLTRACE_P_H
+#define QSCXMLTRACE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtScxml/private/qscxmlglobals_p.h>
+#include <QtCore/qatomic.h>
+#include <QtCore/qstringlist.h>
+
+QT_BEGIN_NAMESPACE
+
+class QIODevice;
+
+namespace QScxmlInternal {
+
+// One fixed-size entry in a trace buffer. What index and value hold depends on the type.
+struct TraceRecord
+{
+    enum Type : quint8 {
+        MacrostepBegin,
+        MacrostepEnd,
+        EventTaken,      // index: event name id, value: 1 for internal events
+        MicrostepBegin,  // value: number of enabled transitions
+        MicrostepEnd,
+        TransitionTaken, // index: transition
+        StateExited,     // index: state
+        StateEntered,    // index: state
+        GuardEvaluated   // index: transition, value: duration in ns, flag: result
+    };
+
+    quint64 timestamp; // ns since tracing was enabled
+    quint32 machine;
+    Type type;
+    quint8 flag;
+    quint16 reserved;
+    qint32 index;
+    qint32 value;
+};
+
+// A binary trace of what state machines do, kept in one ring buffer per thread. Recording does
+// not allocate, format, or lock. Callers are expected to check isEnabled() first, so that tracing
+// costs a single branch while it is off.
+//
+// Setting QT_SCXML_TRACE to a file name enables tracing at startup, and writes the trace to that
+// file in the Chrome trace event format when the QCoreApplication is destroyed. Applications
+// without one can call writeChromeTrace() themselves. The result can be opened in Perfetto or
+// chrome://tracing.
+//
+// A thread's buffer is handed to the next thread that records once the thread exits, so the
+// memory used is bounded by the number of threads recording at the same time.
+class Q_SCXML_PRIVATE_EXPORT Trace
+{
+public:
+    enum { BufferSize = 1 << 16 }; // records per thread
+    enum { MaxEventNames = 1 << 12 };
+
+    static bool isEnabled()
+    { return enabled.loadRelaxed(); }
+
+    static void setEnabled(bool on);
+    static void clear();
+
+    static quint32 registerMachine(const QString &name, const QString &sessionId,
+                                   const QStringList &states, const QStringList &transitions);
+    static quint32 eventNameId(const QString &name);
+    static quint64 timestamp();
+    static void record(quint32 machine, TraceRecord::Type type, qint32 index = 0,
+                       qint32 value = 0, quint8 flag = 0);
+
+    // Converts the recorded traces into the Chrome trace event format. The result is exact if no
+    // state machine is running meanwhile.
+    static bool writeChromeTrace(QIODevice *device);
+    static bool writeChromeTrace(const QString &fileName);
+
+private:
+    static QBasicAtomicInt enabled;
+};
+
+} // QScxmlInternal namespace
+
+QT_END_NAMESPACE
+
+#endif // QSCXMLTRACE_P_H
@@ -40,11 +40,16 @@
 #include "statemachineloader_p.h"
 
 #include <QtScxml/qscxmlstatemachine.h>
+#include <QtScxml/private/qscxmlcompiler_p.h>
 #include <qqmlcontext.h>
 #include <qqmlengine.h>
 #include <qqmlinfo.h>
 #include <qqmlfile.h>
 #include <qbuffer.h>
+#include <qfile.h>
+#include <qfuturewatcher.h>
+#include <qpromise.h>
+#include <qthreadpool.h>
 
 /*!
     \qmltype StateMachineLoader
@@ -62,6 +67,11 @@ QScxmlStateMachineLoader::QScxmlStateMachineLoader(QObject *parent)
 {
 }
 
+QScxmlStateMachineLoader::~QScxmlStateMachineLoader()
+{
+    cancelLoading();
+}
+
 /*!
     \qmlproperty ScxmlStateMachine StateMachineLoader::stateMachine
 
@@ -89,7 +99,7 @@ QBindable<QScxmlStateMachine*> QScxmlStateMachineLoader::bindableStateMachine()
     \qmlproperty url StateMachineLoader::source
 
     The URL of the SCXML document to load. Only synchronously accessible URLs
-    are supported.
+    are supported, unless \l asynchronous is \c true.
  */
 QUrl QScxmlStateMachineLoader::source()
 {
@@ -104,12 +114,19 @@ void QScxmlStateMachineLoader::setSource(const QUrl &source)
     const QUrl oldSource = m_source;
     setStateMachine(nullptr);
     m_implicitDataModel = nullptr;
+    cancelLoading();
 
-    if (parse(source))
+    const bool ok = m_asynchronous.value() ? load(source) : parse(source);
+    if (ok)
         m_source = source;
     else
         m_source = QUrl();
 
+    if (!ok)
+        m_status = Error;
+    else
+        m_status = m_stateMachine.value() ? Ready : Loading;
+
     if (oldSource != m_source)
         m_source.notify();
 }
@@ -167,39 +184,72 @@ QBindable<QScxmlDataModel*> QScxmlStateMachineLoader::bindableDataModel()
     return &m_dataModel;
 }
 
-bool QScxmlStateMachineLoader::parse(const QUrl &source)
+/*!
+    \qmlproperty bool StateMachineLoader::asynchronous
+    \since QtScxml 6.4
+
+    Whether the SCXML document is loaded asynchronously. The default is \c false.
+
+    When \c true, reading, parsing and verifying the document, as well as
+    building the state table, happen on a worker thread. Only the state machine
+    object itself is created on the thread the loader lives in. In this mode
+    \l source may also be a network URL.
+
+    Changing this property does not reload the current \l source.
+
+    \sa status
+ */
+bool QScxmlStateMachineLoader::asynchronous() const
 {
-    if (!QQmlFile::isSynchronous(source)) {
-        qmlWarning(this) << QStringLiteral("Cannot open '%1' for reading: only synchronous access is supported.")
-                         .arg(source.url());
-        return false;
-    }
-    QQmlFile scxmlFile(QQmlEngine::contextForObject(this)->engine(), source);
-    if (scxmlFile.isError()) {
-        // the synchronous case can only fail when the file is not found (or not readable).
-        qmlWarning(this) << QStringLiteral("Cannot open '%1' for reading.").arg(source.url());
-        return false;
-    }
+    return m_asynchronous;
+}
 
-    QByteArray data(scxmlFile.dataByteArray());
-    QBuffer buf(&data);
-    if (!buf.open(QIODevice::ReadOnly)) {
-        qmlWarning(this) << QStringLiteral("Cannot open input buffer for reading");
-        return false;
-    }
+void QScxmlStateMachineLoader::setAsynchronous(bool asynchronous)
+{
+    m_asynchronous = asynchronous;
+}
 
-    QString fileName;
-    if (source.isLocalFile()) {
-        fileName = source.toLocalFile();
-    } else if (source.scheme() == QStringLiteral("qrc")) {
-        fileName = QStringLiteral(":") + source.path();
-    } else {
-        qmlWarning(this) << QStringLiteral("%1 is neither a local nor a resource URL.")
-                            .arg(source.url())
-                         << QStringLiteral("Invoking services by relative path will not work.");
-    }
+QBindable<bool> QScxmlStateMachineLoader::bindableAsynchronous()
+{
+    return &m_asynchronous;
+}
 
-    auto stateMachine = QScxmlStateMachine::fromData(&buf, fileName);
+/*!
+    \qmlproperty enumeration StateMachineLoader::status
+    \since QtScxml 6.4
+
+    The status of loading the state machine:
+
+    \value StateMachineLoader.Null     No document has been loaded.
+    \value StateMachineLoader.Ready    The state machine has been instantiated.
+    \value StateMachineLoader.Loading  The document is being loaded asynchronously.
+    \value StateMachineLoader.Error    The document could not be loaded.
+ */
+QScxmlStateMachineLoader::Status QScxmlStateMachineLoader::status() const
+{
+    return m_status;
+}
+
+QBindable<QScxmlStateMachineLoader::Status> QScxmlStateMachineLoader::bindableStatus()
+{
+    return &m_status;
+}
+
+QString QScxmlStateMachineLoader::fileName(const QUrl &source)
+{
+    if (source.isLocalFile())
+        return source.toLocalFile();
+    if (source.scheme() == QStringLiteral("qrc"))
+        return QStringLiteral(":") + source.path();
+
+    qmlWarning(this) << QStringLiteral("%1 is neither a local nor a resource URL.")
+                        .arg(source.url())
+                     << QStringLiteral("Invoking services by relative path will not work.");
+    return QString();
+}
+
+bool QScxmlStateMachineLoader::setUp(QScxmlStateMachine *stateMachine, const QUrl &source)
+{
     stateMachine->setParent(this);
     m_implicitDataModel = stateMachine->dataModel();
 
@@ -223,3 +273,133 @@ bool QScxmlStateMachineLoader::parse(const QUrl &source)
         return false;
     }
 }
+
+bool QScxmlStateMachineLoader::parse(const QUrl &source)
+{
+    if (!QQmlFile::isSynchronous(source)) {
+        qmlWarning(this) << QStringLiteral("Cannot open '%1' for reading: only synchronous access is supported.")
+                         .arg(source.url());
+        return false;
+    }
+    QQmlFile scxmlFile(QQmlEngine::contextForObject(this)->engine(), source);
+    if (scxmlFile.isError()) {
+        // the synchronous case can only fail when the file is not found (or not readable).
+        qmlWarning(this) << QStringLiteral("Cannot open '%1' for reading.").arg(source.url());
+        return false;
+    }
+
+    QByteArray data(scxmlFile.dataByteArray());
+    QBuffer buf(&data);
+    if (!buf.open(QIODevice::ReadOnly)) {
+        qmlWarning(this) << QStringLiteral("Cannot open input buffer for reading");
+        return false;
+    }
+
+    return setUp(QScxmlStateMachine::fromData(&buf, fileName(source)), source);
+}
+
+bool QScxmlStateMachineLoader::load(const QUrl &source)
+{
+    m_loadingSource = source;
+    if (QQmlFile::isSynchronous(source)) {
+        const QString localFile = QQmlFile::urlToLocalFileOrQrc(source);
+        if (!QFile::exists(localFile)) {
+            qmlWarning(this) << QStringLiteral("Cannot open '%1' for reading.").arg(source.url());
+            return false;
+        }
+        compile(localFile, QByteArray());
+        return true;
+    }
+
+    m_file.reset(new QQmlFile(QQmlEngine::contextForObject(this)->engine(), source));
+    if (m_file->isLoading()) {
+        m_file->connectFinished(this, SLOT(fileFinished()));
+        return true;
+    }
+
+    const std::unique_ptr<QQmlFile> file = std::move(m_file);
+    if (file->isError()) {
+        qmlWarning(this) << QStringLiteral("Cannot open '%1' for reading: %2")
+                            .arg(source.url(), file->error());
+        return false;
+    }
+    compile(QString(), file->dataByteArray());
+    return true;
+}
+
+void QScxmlStateMachineLoader::fileFinished()
+{
+    const std::unique_ptr<QQmlFile> file = std::move(m_file);
+    if (!file)
+        return;
+
+    if (file->isError()) {
+        qmlWarning(this) << QStringLiteral("Cannot open '%1' for reading: %2")
+                            .arg(m_loadingSource.url(), file->error());
+        m_loadingSource = QUrl();
+        m_source = QUrl();
+        m_source.notify();
+        m_status = Error;
+        return;
+    }
+
+    compile(QString(), file->dataByteArray());
+}
+
+void QScxmlStateMachineLoader::compile(const QString &localFile, const QByteArray &data)
+{
+    using QScxmlInternal::PreparedStateMachine;
+
+    const QString name = fileName(m_loadingSource);
+    auto promise = std::make_shared<QPromise<PreparedStateMachine>>();
+    m_watcher = new QFutureWatcher<PreparedStateMachine>(this);
+    connect(m_watcher, &QFutureWatcherBase::finished, this, &QScxmlStateMachineLoader::compiled);
+    m_watcher->setFuture(promise->future());
+
+    // Everything up to the state table is plain data and can be built off the GUI thread. The
+    // QObjects making up the state machine are created in compiled(), on the loader's thread.
+    QThreadPool::globalInstance()->start([promise, localFile, data, name]() {
+        promise->start();
+        if (!promise->isCanceled()) {
+            QByteArray content = data;
+            if (!localFile.isEmpty()) {
+                QFile file(localFile);
+                if (file.open(QIODevice::ReadOnly))
+                    content = file.readAll();
+            }
+            promise->addResult(PreparedStateMachine::prepare(content, name));
+        }
+        promise->finish();
+    });
+}
+
+void QScxmlStateMachineLoader::compiled()
+{
+    QFutureWatcher<QScxmlInternal::PreparedStateMachine> *watcher = m_watcher;
+    m_watcher = nullptr;
+    watcher->deleteLater();
+    if (watcher->future().resultCount() == 0)
+        return;
+
+    const QUrl source = m_loadingSource;
+    m_loadingSource = QUrl();
+    if (setUp(watcher->future().result().instantiate(), source)) {
+        m_status = Ready;
+    } else {
+        m_source = QUrl();
+        m_source.notify();
+        m_status = Error;
+    }
+}
+
+void QScxmlStateMachineLoader::cancelLoading()
+{
+    m_file.reset();
+    if (m_watcher) {
+        m_watcher->disconnect(this);
+        m_watcher->future().cancel();
+        delete m_watcher;
+        m_watcher = nullptr;
+    }
+    m_loadingSource = QUrl();
+}
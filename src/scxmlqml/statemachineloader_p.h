@@ -59,7 +59,14 @@
 #include <QtCore/private/qproperty_p.h>
 #include <QtQml/qqml.h>
 
+#include <memory>
+
 QT_BEGIN_NAMESPACE
+class QQmlFile;
+template <typename T> class QFutureWatcher;
+namespace QScxmlInternal {
+class PreparedStateMachine;
+}
 
 class Q_SCXMLQML_PRIVATE_EXPORT QScxmlStateMachineLoader: public QObject
 {
@@ -72,11 +79,19 @@ class Q_SCXMLQML_PRIVATE_EXPORT QScxmlStateMachineLoader: public QObject
                NOTIFY initialValuesChanged BINDABLE bindableInitialValues)
     Q_PROPERTY(QScxmlDataModel *dataModel READ dataModel
                WRITE setDataModel NOTIFY dataModelChanged BINDABLE bindableDataModel)
+    Q_PROPERTY(bool asynchronous READ asynchronous WRITE setAsynchronous
+               NOTIFY asynchronousChanged BINDABLE bindableAsynchronous REVISION(6, 4))
+    Q_PROPERTY(Status status READ status NOTIFY statusChanged BINDABLE bindableStatus
+               REVISION(6, 4))
     QML_NAMED_ELEMENT(StateMachineLoader)
     QML_ADDED_IN_VERSION(5,8)
 
 public:
+    enum Status { Null, Ready, Loading, Error };
+    Q_ENUM(Status)
+
     explicit QScxmlStateMachineLoader(QObject *parent = nullptr);
+    ~QScxmlStateMachineLoader() override;
 
     QScxmlStateMachine *stateMachine() const;
     QBindable<QScxmlStateMachine*> bindableStateMachine();
@@ -93,14 +108,32 @@ public:
     void setDataModel(QScxmlDataModel *dataModel);
     QBindable<QScxmlDataModel*> bindableDataModel();
 
+    bool asynchronous() const;
+    void setAsynchronous(bool asynchronous);
+    QBindable<bool> bindableAsynchronous();
+
+    Status status() const;
+    QBindable<Status> bindableStatus();
+
 Q_SIGNALS:
     void sourceChanged();
     void initialValuesChanged();
     void stateMachineChanged();
     void dataModelChanged();
+    Q_REVISION(6, 4) void asynchronousChanged();
+    Q_REVISION(6, 4) void statusChanged();
+
+private Q_SLOTS:
+    void fileFinished();
 
 private:
     bool parse(const QUrl &source);
+    bool load(const QUrl &source);
+    void compile(const QString &localFile, const QByteArray &data);
+    void compiled();
+    void cancelLoading();
+    bool setUp(QScxmlStateMachine *stateMachine, const QUrl &source);
+    QString fileName(const QUrl &source);
     void setStateMachine(QScxmlStateMachine* stateMachine);
 
 private:
@@ -115,7 +148,16 @@ private:
                              &QScxmlStateMachineLoader::dataModelChanged, nullptr);
     Q_OBJECT_BINDABLE_PROPERTY_WITH_ARGS(QScxmlStateMachineLoader, QScxmlStateMachine*,
                              m_stateMachine, nullptr, &QScxmlStateMachineLoader::stateMachineChanged);
+    Q_OBJECT_BINDABLE_PROPERTY_WITH_ARGS(QScxmlStateMachineLoader, bool, m_asynchronous, false,
+                                         &QScxmlStateMachineLoader::asynchronousChanged);
+    Q_OBJECT_BINDABLE_PROPERTY_WITH_ARGS(QScxmlStateMachineLoader, Status, m_status, Null,
+                                         &QScxmlStateMachineLoader::statusChanged);
     QScxmlDataModel *m_implicitDataModel;
+
+    // Pending asynchronous load: either a network fetch or a compilation on the thread pool.
+    QUrl m_loadingSource;
+    std::unique_ptr<QQmlFile> m_file;
+    QFutureWatcher<QScxmlInternal::PreparedStateMachine> *m_watcher = nullptr;
 };
 
 QT_END_NAMESPACE
@@ -50,11 +50,15 @@
 #include <private/qjsvalue_p.h>
 #include <private/qv4scopedvalue_p.h>
 #include <private/qqmlcontext_p.h>
+#include <private/qqmlscriptstring_p.h>
 
 SignalTransition::SignalTransition(QState *parent)
     : QSignalTransition(this, SIGNAL(invokeYourself()), parent), m_complete(false), m_signalExpression(nullptr)
 {
     connect(this, &SignalTransition::signalChanged, [this](){ m_signal.notify(); });
+    connect(this, &SignalTransition::signalChanged, this, &SignalTransition::invalidateGuard);
+    connect(this, &SignalTransition::senderObjectChanged, this, &SignalTransition::invalidateGuard);
+    connect(this, &SignalTransition::guardChanged, this, &SignalTransition::invalidateGuard);
 }
 
 bool SignalTransition::eventTest(QEvent *event)
@@ -66,18 +70,98 @@ bool SignalTransition::eventTest(QEvent *event)
     if (m_guard.value().isEmpty())
         return true;
 
+    QStateMachine::SignalEvent *e = static_cast<QStateMachine::SignalEvent*>(event);
+    if (m_compiledGuard == CompiledGuard::None)
+        compileGuard(e);
+
+    switch (m_compiledGuard) {
+    case CompiledGuard::Constant:
+        return m_guardConstant;
+    case CompiledGuard::Function: {
+        QJSEngine *engine = qmlEngine(this);
+        QJSValueList arguments;
+        const QVariantList eventArguments = e->arguments();
+        arguments.reserve(eventArguments.count());
+        for (const QVariant &argument : eventArguments)
+            arguments.append(engine->toScriptValue(argument));
+        const QJSValue result = m_guardFunction.call(arguments);
+        if (result.isError()) {
+            qmlWarning(this) << result.toString();
+            return false;
+        }
+        return result.toBool();
+    }
+    case CompiledGuard::None:
+    case CompiledGuard::Expression:
+        break;
+    }
+
+    return evaluateGuardExpression(e);
+}
+
+void SignalTransition::compileGuard(const QStateMachine::SignalEvent *event)
+{
+    const QQmlScriptString &guard = m_guard.value();
+
+    bool isLiteral = false;
+    m_guardConstant = guard.booleanLiteral(&isLiteral);
+    if (isLiteral) {
+        m_compiledGuard = CompiledGuard::Constant;
+        return;
+    }
+
+    // Anything that cannot be wrapped into a function is evaluated the slow way, by creating an
+    // expression in a fresh context on every emission.
+    m_compiledGuard = CompiledGuard::Expression;
+
+    QQmlContext *outerContext = QQmlEngine::contextForObject(this);
+    if (!outerContext || !qmlEngine(this))
+        return;
+
+    // A trailing semicolon would end up inside the parentheses of the return statement.
+    QString script = QQmlScriptStringPrivate::get(guard)->script;
+    while (!script.isEmpty() && (script.back().isSpace() || script.back() == QLatin1Char(';')))
+        script.chop(1);
+    if (script.isEmpty())
+        return;
+
+    const QMetaMethod metaMethod = event->sender()->metaObject()->method(event->signalIndex());
+    const auto parameterNames = metaMethod.parameterNames();
+    QStringList arguments;
+    arguments.reserve(parameterNames.count());
+    for (int i = 0; i < parameterNames.count(); ++i) {
+        arguments.append(parameterNames[i].isEmpty()
+                         ? QStringLiteral("__qt_unnamed_argument_%1").arg(i)
+                         : QString::fromUtf8(parameterNames[i]));
+    }
+
+    // The function closes over the transition's context and scope, so ids and properties
+    // resolve like they do in the guard binding. Signal parameters shadow them as arguments.
+    // The closing parenthesis goes on its own line, so that a trailing line comment in the guard
+    // does not comment it out.
+    QQmlExpression expression(outerContext, this,
+                              QStringLiteral("(function(%1) { return (%2\n); })")
+                              .arg(arguments.join(QLatin1Char(',')), script));
+    const QJSValue function = expression.evaluate().value<QJSValue>();
+    if (expression.hasError() || !function.isCallable())
+        return;
+
+    m_guardFunction = function;
+    m_compiledGuard = CompiledGuard::Function;
+}
+
+bool SignalTransition::evaluateGuardExpression(const QStateMachine::SignalEvent *event)
+{
     QQmlContext *outerContext = QQmlEngine::contextForObject(this);
     QQmlContext context(outerContext);
     QQmlContextData::get(&context)->setImports(QQmlContextData::get(outerContext)->imports());
 
-    QStateMachine::SignalEvent *e = static_cast<QStateMachine::SignalEvent*>(event);
-
     // Set arguments as context properties
-    int count = e->arguments().count();
-    QMetaMethod metaMethod = e->sender()->metaObject()->method(e->signalIndex());
+    int count = event->arguments().count();
+    QMetaMethod metaMethod = event->sender()->metaObject()->method(event->signalIndex());
     const auto parameterNames = metaMethod.parameterNames();
     for (int i = 0; i < count; i++)
-        context.setContextProperty(QString::fromUtf8(parameterNames[i]), QVariant::fromValue(e->arguments().at(i)));
+        context.setContextProperty(QString::fromUtf8(parameterNames[i]), QVariant::fromValue(event->arguments().at(i)));
 
     QQmlExpression expr(m_guard.value(), &context, this);
     QVariant result = expr.evaluate();
@@ -85,6 +169,12 @@ bool SignalTransition::eventTest(QEvent *event)
     return result.toBool();
 }
 
+void SignalTransition::invalidateGuard()
+{
+    m_compiledGuard = CompiledGuard::None;
+    m_guardFunction = QJSValue();
+}
+
 void SignalTransition::onTransition(QEvent *event)
 {
     if (QQmlEnginePrivate *engine = m_signalExpression
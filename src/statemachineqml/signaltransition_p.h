@@ -54,6 +54,7 @@
 #include "qstatemachineqmlglobals_p.h"
 
 #include <QtStateMachine/QSignalTransition>
+#include <QtStateMachine/QStateMachine>
 #include <QtCore/QVariant>
 #include <QtQml/QJSValue>
 
@@ -106,6 +107,9 @@ private:
     void classBegin() override { m_complete = false; }
     void componentComplete() override { m_complete = true; connectTriggered(); }
     void connectTriggered();
+    void compileGuard(const QStateMachine::SignalEvent *event);
+    bool evaluateGuardExpression(const QStateMachine::SignalEvent *event);
+    void invalidateGuard();
 
     friend class SignalTransitionParser;
 
@@ -117,6 +121,13 @@ private:
     QQmlRefPointer<QV4::ExecutableCompilationUnit> m_compilationUnit;
     QList<const QV4::CompiledData::Binding *> m_bindings;
     QQmlRefPointer<QQmlBoundSignalExpression> m_signalExpression;
+
+    // The guard is compiled lazily on the first signal emission, into either a constant or a
+    // JavaScript function taking the signal parameters as arguments.
+    enum class CompiledGuard { None, Constant, Function, Expression };
+    CompiledGuard m_compiledGuard = CompiledGuard::None;
+    bool m_guardConstant = false;
+    QJSValue m_guardFunction;
 };
 
 class SignalTransitionParser : public QQmlCustomParser
@@ -0,0 +1,145 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtQml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "timeoutscheduler_p.h"
+
+#include <QtCore/qcoreevent.h>
+#include <QtStateMachine/QStateMachine>
+
+#include <algorithm>
+
+TimeoutScheduler::TimeoutScheduler(QStateMachine *machine)
+    : QObject(machine)
+{
+    m_clock.start();
+}
+
+TimeoutScheduler *TimeoutScheduler::forMachine(QStateMachine *machine)
+{
+    Q_ASSERT(machine);
+    if (auto scheduler = machine->findChild<TimeoutScheduler *>(QString(),
+                                                                Qt::FindDirectChildrenOnly)) {
+        return scheduler;
+    }
+    return new TimeoutScheduler(machine);
+}
+
+quint64 TimeoutScheduler::schedule(int timeout)
+{
+    const quint64 token = ++m_nextToken;
+    m_deadlines.push_back({ m_clock.elapsed() + qMax(timeout, 0), token });
+    std::push_heap(m_deadlines.begin(), m_deadlines.end());
+    m_pending.insert(token);
+    rearm();
+    return token;
+}
+
+void TimeoutScheduler::cancel(quint64 token)
+{
+    if (!m_pending.remove(token))
+        return;
+
+    // The heap entry stays behind until it reaches the top, or until there are so many stale
+    // entries that a rebuild pays off.
+    if (m_deadlines.size() > 2 * size_t(m_pending.size()) + 16)
+        compact();
+    else if (m_pending.isEmpty())
+        rearm();
+}
+
+void TimeoutScheduler::compact()
+{
+    m_deadlines.erase(std::remove_if(m_deadlines.begin(), m_deadlines.end(),
+                                     [this](const Deadline &deadline) {
+                          return !m_pending.contains(deadline.token);
+                      }), m_deadlines.end());
+    std::make_heap(m_deadlines.begin(), m_deadlines.end());
+    rearm();
+}
+
+void TimeoutScheduler::rearm()
+{
+    while (!m_deadlines.empty() && !m_pending.contains(m_deadlines.front().token)) {
+        std::pop_heap(m_deadlines.begin(), m_deadlines.end());
+        m_deadlines.pop_back();
+    }
+
+    if (m_deadlines.empty()) {
+        m_timer.stop();
+        m_armedFor = -1;
+        return;
+    }
+
+    const qint64 next = m_deadlines.front().time;
+    if (next == m_armedFor && m_timer.isActive())
+        return;
+
+    m_armedFor = next;
+    m_timer.start(int(qMax(next - m_clock.elapsed(), qint64(0))), this);
+}
+
+void TimeoutScheduler::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() != m_timer.timerId()) {
+        QObject::timerEvent(event);
+        return;
+    }
+
+    m_timer.stop();
+    m_armedFor = -1;
+
+    // Collect everything that is due before emitting, as the state machine processes the
+    // resulting signal events directly and may schedule or cancel timeouts meanwhile.
+    const qint64 now = m_clock.elapsed();
+    std::vector<quint64> due;
+    while (!m_deadlines.empty() && m_deadlines.front().time <= now) {
+        const quint64 token = m_deadlines.front().token;
+        std::pop_heap(m_deadlines.begin(), m_deadlines.end());
+        m_deadlines.pop_back();
+        if (m_pending.remove(token))
+            due.push_back(token);
+    }
+
+    rearm();
+
+    for (quint64 token : due)
+        emit timeout(token);
+}
+
+#include "moc_timeoutscheduler_p.cpp"
@@ -0,0 +1,114 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtQml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef TIMEOUTSCHEDULER_H
+#define TIMEOUTSCHEDULER_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qstatemachineqmlglobals_p.h"
+
+#include <QtCore/qbasictimer.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qset.h>
+
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+class QStateMachine;
+
+// Deadline queue shared by all TimeoutTransitions of one state machine. Only the earliest
+// pending deadline has a running timer. Cancelling a timeout forgets its token, and stale heap
+// entries are skipped when they reach the top.
+class Q_STATEMACHINEQML_PRIVATE_EXPORT TimeoutScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static TimeoutScheduler *forMachine(QStateMachine *machine);
+
+    quint64 schedule(int timeout);
+    void cancel(quint64 token);
+
+Q_SIGNALS:
+    void timeout(quint64 token);
+
+protected:
+    void timerEvent(QTimerEvent *event) override;
+
+private:
+    explicit TimeoutScheduler(QStateMachine *machine);
+
+    void rearm();
+    void compact();
+
+    struct Deadline
+    {
+        qint64 time;
+        quint64 token;
+
+        // std heaps are max-heaps, so order by "later" to get the earliest deadline on top.
+        // Tokens are handed out in scheduling order and break ties.
+        bool operator<(const Deadline &other) const
+        {
+            return time > other.time || (time == other.time && token > other.token);
+        }
+    };
+
+    std::vector<Deadline> m_deadlines;
+    QSet<quint64> m_pending;
+    QElapsedTimer m_clock;
+    QBasicTimer m_timer;
+    qint64 m_armedFor = -1;
+    quint64 m_nextToken = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif
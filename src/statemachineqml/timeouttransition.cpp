@@ -38,36 +38,35 @@
 ****************************************************************************/
 
 #include "timeouttransition_p.h"
+#include "timeoutscheduler_p.h"
 
 #include <QQmlInfo>
-#include <QTimer>
 #include <QState>
+#include <QStateMachine>
 
 TimeoutTransition::TimeoutTransition(QState* parent)
-    : QSignalTransition((m_timer = new QTimer), SIGNAL(timeout()), parent)
+    : QSignalTransition(nullptr, SIGNAL(timeout(quint64)), parent)
 {
-    m_timer->setSingleShot(true);
-    m_timer->setInterval(1000);
 }
 
 TimeoutTransition::~TimeoutTransition()
 {
-    delete m_timer;
+    stop();
 }
 
 int TimeoutTransition::timeout() const
 {
-    return m_timer->interval();
+    return m_timeout;
 }
 
 void TimeoutTransition::setTimeout(int timeout)
 {
-    m_timer->setInterval(timeout);
+    m_timeout = timeout;
 }
 
 QBindable<int> TimeoutTransition::bindableTimeout()
 {
-    return m_timer->bindableInterval();
+    return &m_timeout;
 }
 
 void TimeoutTransition::componentComplete()
@@ -78,10 +77,57 @@ void TimeoutTransition::componentComplete()
         return;
     }
 
-    connect(state, SIGNAL(entered()), m_timer, SLOT(start()));
-    connect(state, SIGNAL(exited()), m_timer, SLOT(stop()));
+    if (QStateMachine *stateMachine = machine()) {
+        m_scheduler = TimeoutScheduler::forMachine(stateMachine);
+        setSenderObject(m_scheduler);
+    }
+
+    connect(state, &QState::entered, this, &TimeoutTransition::start);
+    connect(state, &QState::exited, this, &TimeoutTransition::stop);
     if (state->active())
-        m_timer->start();
+        start();
+}
+
+bool TimeoutTransition::eventTest(QEvent *event)
+{
+    if (!QSignalTransition::eventTest(event))
+        return false;
+
+    // All timeout transitions of a machine share the scheduler's signal, so only accept the
+    // deadline this transition armed itself.
+    const auto *signalEvent = static_cast<QStateMachine::SignalEvent *>(event);
+    return m_token != 0 && signalEvent->arguments().value(0).toULongLong() == m_token;
+}
+
+void TimeoutTransition::start()
+{
+    QStateMachine *stateMachine = machine();
+    if (!stateMachine)
+        return;
+
+    if (!m_scheduler || m_scheduler->parent() != stateMachine) {
+        stop();
+        m_scheduler = TimeoutScheduler::forMachine(stateMachine);
+        setSenderObject(m_scheduler);
+    } else if (m_token != 0) {
+        m_scheduler->cancel(m_token);
+    }
+
+    m_token = m_scheduler->schedule(m_timeout.value());
+}
+
+void TimeoutTransition::stop()
+{
+    if (m_token != 0 && m_scheduler)
+        m_scheduler->cancel(m_token);
+    m_token = 0;
+}
+
+void TimeoutTransition::restart()
+{
+    // Like QTimer::setInterval(), changing the timeout restarts a running timeout.
+    if (m_token != 0)
+        start();
 }
 
 /*!
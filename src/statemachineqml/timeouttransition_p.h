@@ -57,9 +57,10 @@
 #include <QtQml/QQmlParserStatus>
 #include <QtQml/qqml.h>
 #include <QtCore/private/qproperty_p.h>
+#include <QtCore/qpointer.h>
 
 QT_BEGIN_NAMESPACE
-class QTimer;
+class TimeoutScheduler;
 
 class Q_STATEMACHINEQML_PRIVATE_EXPORT TimeoutTransition : public QSignalTransition, public QQmlParserStatus
 {
@@ -80,8 +81,18 @@ public:
     void classBegin() override {}
     void componentComplete() override;
 
+protected:
+    bool eventTest(QEvent *event) override;
+
 private:
-    QTimer *m_timer;
+    void start();
+    void stop();
+    void restart();
+
+    Q_OBJECT_BINDABLE_PROPERTY_WITH_ARGS(TimeoutTransition, int, m_timeout, 1000,
+                                         &TimeoutTransition::restart)
+    QPointer<TimeoutScheduler> m_scheduler;
+    quint64 m_token = 0;
 };
 
 QT_END_NAMESPACE
@@ -32,6 +32,7 @@
 #include <QtScxml/qscxmlcompiler.h>
 #include <QtScxml/qscxmlstatemachine.h>
 #include <QtScxml/qscxmlinvokableservice.h>
+#include <QtScxml/private/qscxmlstatemachine_p.h>
 #include "ids1.h"
 #include "statemachineunicodename.h"
 #include "datainnulldatamodel.h"
@@ -40,6 +41,9 @@
 #include "connection.h"
 #include "topmachine.h"
 #include "historyState.h"
+#include "cppdatamodel.h"
+#include "ecmascripttables.h"
+#include "typedpayload.h"
 
 enum { SpyWaitTime = 8000 };
 
@@ -58,6 +62,9 @@ private Q_SLOTS:
     void topMachineDynamic();
     void publicSignals();
     void historyState();
+    void cppDataModel();
+    void staticTables();
+    void typedPayload();
 };
 
 void tst_Compiled::stateNames()
@@ -322,6 +329,62 @@ void tst_Compiled::historyState()
     QCOMPARE(historyStateSM.activeStateNames(), QStringList(QLatin1String("Beta")));
 }
 
+void tst_Compiled::cppDataModel()
+{
+    Counter counter;
+    CounterDataModel dataModel;
+    counter.setDataModel(&dataModel);
+    QSignalSpy logSpy(&counter, &QScxmlStateMachine::log);
+    QSignalSpy finishedSpy(&counter, &QScxmlStateMachine::finished);
+
+    counter.start();
+    for (int i = 0; i < 4; ++i)
+        counter.submitEvent("step");
+    QVERIFY(finishedSpy.wait(SpyWaitTime));
+
+    // The condition, the script, and the log expression all go through the generated tables.
+    QCOMPARE(dataModel.count, 3);
+    QCOMPARE(logSpy.count(), 1);
+    QCOMPARE(logSpy.first().at(1).toString(), QString("3"));
+}
+
+void tst_Compiled::staticTables()
+{
+    EcmaScriptTables machine;
+    const QScxmlTableData::StaticTables *tables
+            = QScxmlStateMachinePrivate::get(&machine)->staticTables();
+    QVERIFY(tables);
+    QCOMPARE(tables->dataNameCount, 3);
+    QCOMPARE(tables->foreachCount, 1);
+
+    // The <data>, <assign>, and <foreach> elements are read from the static tables.
+    QSignalSpy finishedSpy(&machine, &QScxmlStateMachine::finished);
+    machine.start();
+    QVERIFY(finishedSpy.wait(SpyWaitTime));
+    QCOMPARE(machine.dataModel()->scxmlProperty(QLatin1String("sum")).toInt(), 6);
+    QCOMPARE(machine.dataModel()->scxmlProperty(QLatin1String("last")).toInt(), 2);
+}
+
+void tst_Compiled::typedPayload()
+{
+    TypedPayload machine;
+    ReadingDataModel dataModel;
+    machine.setDataModel(&dataModel);
+    QSignalSpy finishedSpy(&machine, &QScxmlStateMachine::finished);
+
+    machine.start();
+    machine.submitEvent("reading", QVariant::fromValue(Reading{ 21.5, QStringLiteral("C") }));
+    machine.submitEvent("reading", QVariant::fromValue(Reading{ 0.5, QStringLiteral("C") }));
+    machine.submitEvent("reading", 7); // not a Reading, so the guard doesn't hold
+    machine.submitEvent("done");
+    QVERIFY(finishedSpy.wait(SpyWaitTime));
+
+    // The data model read the payloads submitted from C++ in place.
+    QCOMPARE(dataModel.readings, 2);
+    QCOMPARE(dataModel.total, 22.0);
+    QCOMPARE(dataModel.unit, QStringLiteral("C"));
+}
+
 QTEST_MAIN(tst_Compiled)
 
 #include "tst_compiled.moc"
@@ -55,6 +55,7 @@ private slots:
     void stateMachineLoaderInitialValuesBinding();
     void stateMachineLoaderSourceStateMachineBinding();
     void stateMachineLoaderDatamodelBinding();
+    void stateMachineLoaderAsynchronous();
 
 private:
     QScxmlEventConnection m_eventConnection;
@@ -195,5 +196,49 @@ void tst_scxmlqmlcpp::stateMachineLoaderDatamodelBinding()
     m_stateMachineLoader.setDataModel(nullptr); // tidy up
 }
 
+void tst_scxmlqmlcpp::stateMachineLoaderAsynchronous()
+{
+    QQmlEngine engine;
+    QQmlComponent component(&engine);
+    component.setData(
+                "import QtQuick;\n"
+                "import QtScxml;\n"
+                "Item { StateMachineLoader { objectName: 'sml'; asynchronous: true } }",
+                QUrl());
+    std::unique_ptr<QObject> root(component.create());
+    QScxmlStateMachineLoader *sml =
+            qobject_cast<QScxmlStateMachineLoader*>(root->findChild<QObject*>("sml"));
+    QVERIFY(sml != nullptr);
+    QVERIFY(sml->asynchronous());
+    QCOMPARE(sml->status(), QScxmlStateMachineLoader::Null);
+
+    QSignalSpy statusSpy(sml, &QScxmlStateMachineLoader::statusChanged);
+    sml->setSource(QUrl(QStringLiteral("qrc:///statemachine.scxml")));
+    QCOMPARE(sml->status(), QScxmlStateMachineLoader::Loading);
+    QVERIFY(sml->stateMachine() == nullptr);
+    QTRY_COMPARE(sml->status(), QScxmlStateMachineLoader::Ready);
+    QVERIFY(sml->stateMachine() != nullptr);
+    QTRY_VERIFY(sml->stateMachine()->isRunning());
+    QCOMPARE(statusSpy.count(), 2);
+
+    // A second load replaces the first one before it finishes
+    sml->setSource(QUrl(QStringLiteral("qrc:///topmachine.scxml")));
+    sml->setSource(QUrl(QStringLiteral("qrc:///statemachine.scxml")));
+    QTRY_COMPARE(sml->status(), QScxmlStateMachineLoader::Ready);
+    QCOMPARE(sml->source(), QUrl(QStringLiteral("qrc:///statemachine.scxml")));
+    QCOMPARE(sml->stateMachine()->name(), QStringLiteral("TrafficLightStateMachine"));
+
+    QTest::ignoreMessage(QtWarningMsg,
+                        "<Unknown File>:3:8: QML StateMachineLoader: :/brokenstatemachine.scxml:59:1: error: initial state 'working' not found for <scxml> element");
+    QTest::ignoreMessage(QtWarningMsg,
+                        "SCXML document has errors");
+    QTest::ignoreMessage(QtWarningMsg,
+                        "<Unknown File>:3:8: QML StateMachineLoader: Something went wrong while parsing 'qrc:///brokenstatemachine.scxml':\n");
+    sml->setSource(QUrl(QStringLiteral("qrc:///brokenstatemachine.scxml")));
+    QTRY_COMPARE(sml->status(), QScxmlStateMachineLoader::Error);
+    QVERIFY(sml->stateMachine() == nullptr);
+    QCOMPARE(sml->source(), QUrl());
+}
+
 QTEST_MAIN(tst_scxmlqmlcpp)
 #include "tst_scxmlqmlcpp.moc"
@@ -54,7 +54,56 @@ TestCase {
         signalName: "activeChanged"
     }
 
+    StateMachine {
+        id: guardMachine
+        initialState: guardRoot
+        State {
+            id: guardRoot
+            initialState: waiting
+            SignalTransition {
+                signal: testCase.reset
+                targetState: waiting
+            }
+            State {
+                id: waiting
+                // Constant guard, folded when the signal is first emitted.
+                SignalTransition {
+                    signal: testCase.guarded
+                    guard: false
+                    targetState: never
+                }
+                // Guards wrapped into a function of the signal parameters.
+                SignalTransition {
+                    signal: testCase.guarded
+                    guard: value > 10 // large values only
+                    targetState: large
+                }
+                SignalTransition {
+                    signal: testCase.guarded
+                    guard: value < 0;
+                    targetState: negative
+                }
+                // A block cannot be wrapped, so it is evaluated as an expression.
+                SignalTransition {
+                    signal: testCase.guarded
+                    guard: {
+                        if (value === 5)
+                            return true;
+                        return false;
+                    }
+                    targetState: five
+                }
+            }
+            State { id: never }
+            State { id: large }
+            State { id: negative }
+            State { id: five }
+        }
+    }
+
     signal mysignal()
+    signal guarded(int value)
+    signal reset()
 
     name: "testSignalTransition"
     function test_signalTransition()
@@ -68,4 +117,38 @@ TestCase {
         tryCompare(finalStateActive, "count", 1)
         tryCompare(machine, "running", false)
     }
+
+    function test_guards()
+    {
+        guardMachine.start()
+        tryCompare(waiting, "active", true)
+
+        testCase.guarded(1)
+        compare(waiting.active, true)
+
+        testCase.guarded(11)
+        tryCompare(large, "active", true)
+        testCase.reset()
+        tryCompare(waiting, "active", true)
+
+        testCase.guarded(-1)
+        tryCompare(negative, "active", true)
+        testCase.reset()
+        tryCompare(waiting, "active", true)
+
+        testCase.guarded(5)
+        tryCompare(five, "active", true)
+        testCase.reset()
+        tryCompare(waiting, "active", true)
+
+        // The guards are compiled on the first emission; later ones reuse them.
+        testCase.guarded(10)
+        compare(waiting.active, true)
+        testCase.guarded(12)
+        tryCompare(large, "active", true)
+        compare(never.active, false)
+
+        guardMachine.stop()
+        tryCompare(guardMachine, "running", false)
+    }
 }
@@ -0,0 +1,99 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+import QtTest
+import QtQml.StateMachine
+
+TestCase {
+    StateMachine {
+        id: machine
+        initialState: waiting
+        State {
+            id: waiting
+            TimeoutTransition {
+                id: slowTimeout
+                targetState: slow
+                timeout: 5000
+            }
+            TimeoutTransition {
+                id: fastTimeout
+                targetState: fast
+                timeout: 20
+            }
+        }
+        State {
+            id: fast
+            SignalTransition {
+                id: back
+                targetState: waiting
+            }
+        }
+        State {
+            id: slow
+        }
+    }
+
+    SignalSpy {
+        id: fastSpyActive
+        target: fast
+        signalName: "activeChanged"
+    }
+
+    SignalSpy {
+        id: slowSpyActive
+        target: slow
+        signalName: "activeChanged"
+    }
+
+    name: "testTimeoutTransition"
+    function test_earliestDeadlineWins()
+    {
+        machine.start();
+        tryCompare(machine, "running", true);
+        tryCompare(fastSpyActive, "count", 1);
+        compare(fast.active, true);
+
+        // Re-entering the source state re-arms both timeouts; the pending slow one was
+        // cancelled on exit and must not fire.
+        for (var i = 1; i <= 3; ++i) {
+            back.invoke();
+            tryCompare(fastSpyActive, "count", i * 2 + 1);
+        }
+        compare(slowSpyActive.count, 0);
+
+        // Changing the timeout of an armed transition restarts it.
+        back.invoke();
+        fastTimeout.timeout = 5000;
+        slowTimeout.timeout = 20;
+        tryCompare(slowSpyActive, "count", 1);
+        compare(fast.active, false);
+        machine.stop();
+        tryCompare(machine, "running", false);
+    }
+}
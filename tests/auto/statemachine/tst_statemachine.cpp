@@ -30,16 +30,28 @@
 #include <QtTest/private/qpropertytesthelper_p.h>
 #include <QObject>
 #include <QXmlStreamReader>
+#include <QtQml/qjsengine.h>
 #include <QtScxml/qscxmlcompiler.h>
 #include <QtScxml/qscxmlstatemachine.h>
 #include <QtScxml/qscxmlinvokableservice.h>
+#include <QtScxml/private/qscxmlclock_p.h>
+#include <QtScxml/private/qscxmleventlog_p.h>
 #include <QtScxml/private/qscxmlstatemachine_p.h>
+#include <QtScxml/private/qscxmltrace_p.h>
 #include <QtScxml/QScxmlNullDataModel>
 
 #include "topmachine.h"
 
 enum { SpyWaitTime = 8000 };
 
+struct Reading
+{
+    double value;
+    qint64 timestamp;
+    QString unit;
+};
+Q_DECLARE_METATYPE(Reading)
+
 class tst_StateMachine: public QObject
 {
     Q_OBJECT
@@ -60,6 +72,20 @@ private Q_SLOTS:
     void invokeStateMachine();
 
     void multipleInvokableServices(); // QTBUG-61484
+    void recycleInvokedStateMachine();
+    void threadedInvocation();
+    void jsonLiteralData();
+    void typedEventData();
+    void binaryTrace();
+    void traceBuffers();
+    void snapshot();
+    void snapshotWithInvokedChild();
+    void eventLog();
+    void virtualClock();
+    void boundedQueue();
+    void mutuallyBlockingSenders();
+    void coalescingAndPriorities();
+    void duplicateDescriptors();
     void logWithoutExpr();
 
     void bindings();
@@ -450,6 +476,227 @@ void tst_StateMachine::multipleInvokableServices()
     QVERIFY(stateMachine->activeStateNames(true).contains(QLatin1String("success")));
 }
 
+void tst_StateMachine::recycleInvokedStateMachine()
+{
+    QScopedPointer<QScxmlStateMachine> stateMachine(
+                QScxmlStateMachine::fromFile(QString(":/tst_statemachine/recycleinvoke.scxml")));
+    QVERIFY(!stateMachine.isNull());
+
+    stateMachine->start();
+    QTRY_COMPARE(stateMachine->invokedServices().length(), 1);
+    QScxmlInvokableService *service = stateMachine->invokedServices().first();
+    QScxmlStateMachine *subMachine
+            = qvariant_cast<QScxmlStateMachine *>(service->property("stateMachine"));
+    QVERIFY(subMachine);
+    QTRY_VERIFY(subMachine->activeStateNames().contains("here"));
+    const QString firstSessionId = subMachine->sessionId();
+    const QJSEngine *engine = subMachine->findChild<QJSEngine *>();
+    QVERIFY(engine);
+
+    subMachine->submitEvent("goThere");
+    QTRY_VERIFY(subMachine->activeStateNames().contains("there"));
+    subMachine->submitEvent("goHere");
+    QTRY_VERIFY(subMachine->activeStateNames().contains("here"));
+    QCOMPARE(subMachine->dataModel()->scxmlProperty("visits").toInt(), 2);
+
+    stateMachine->submitEvent("leave");
+    QTRY_VERIFY(stateMachine->activeStateNames().contains("idle"));
+    QVERIFY(stateMachine->invokedServices().isEmpty());
+    QVERIFY(!subMachine->isRunning());
+    QVERIFY(subMachine->activeStateNames().isEmpty());
+
+    // The second invocation reuses the child, but starts it from scratch.
+    stateMachine->submitEvent("enter");
+    QTRY_COMPARE(stateMachine->invokedServices().length(), 1);
+    QCOMPARE(stateMachine->invokedServices().first(), service);
+    QTRY_VERIFY(subMachine->activeStateNames().contains("here"));
+    QVERIFY(subMachine->isRunning());
+    QVERIFY(subMachine->sessionId() != firstSessionId);
+    QCOMPARE(subMachine->dataModel()->scxmlProperty("visits").toInt(), 1);
+    // Only the variables are reset, the engine is kept.
+    QVERIFY(subMachine->findChild<QJSEngine *>() == engine);
+}
+
+void tst_StateMachine::threadedInvocation()
+{
+    QScopedPointer<QScxmlStateMachine> stateMachine(
+                QScxmlStateMachine::fromFile(QString(":/tst_statemachine/threadedinvoke.scxml")));
+    QVERIFY(!stateMachine.isNull());
+    stateMachine->setThreadedInvocation(true);
+
+    QThread *childThread = nullptr;
+    QObject::connect(stateMachine.data(), &QScxmlStateMachine::invokedServicesChanged,
+                     [&childThread](const QList<QScxmlInvokableService *> &services) {
+        if (services.isEmpty())
+            return;
+        QScxmlStateMachine *subMachine = qvariant_cast<QScxmlStateMachine *>(
+                    services.first()->property("stateMachine"));
+        QVERIFY(subMachine);
+        childThread = subMachine->thread();
+    });
+
+    QSignalSpy finishedSpy(stateMachine.data(), SIGNAL(finished()));
+    stateMachine->start();
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QVERIFY(childThread != nullptr);
+    QVERIFY(childThread != QThread::currentThread());
+
+    // The child's events arrive in the order they were sent, and it answers the parent's events.
+    QCOMPARE(stateMachine->activeStateNames(), QStringList(QLatin1String("success")));
+    QVERIFY(stateMachine->invokedServices().isEmpty());
+}
+
+void tst_StateMachine::jsonLiteralData()
+{
+    // What is kept about the first document's initializers must not affect the second one, even
+    // if its tables end up at the same address.
+    for (int session = 0; session < 2; ++session) {
+        QScopedPointer<QScxmlStateMachine> stateMachine(
+                    QScxmlStateMachine::fromFile(QString(":/tst_statemachine/jsonliterals.scxml")));
+        QVERIFY(!stateMachine.isNull());
+        QScxmlDataModel *dataModel = stateMachine->dataModel();
+
+        stateMachine->start();
+        QTRY_VERIFY(stateMachine->activeStateNames().contains("inherited"));
+
+        QCOMPARE(dataModel->scxmlProperty("number").toInt(), 42);
+        QCOMPARE(dataModel->scxmlProperty("text").toString(), QString("forty-two"));
+        const QVariantMap object = dataModel->scxmlProperty("object").toMap();
+        QCOMPARE(object.value("a").toInt(), 1);
+        QCOMPARE(object.value("b").toList().size(), 2);
+        QVERIFY(object.value("b").toList().first().toBool());
+        const QVariantList array = dataModel->scxmlProperty("array").toList();
+        QCOMPARE(array.size(), 3);
+        QCOMPARE(array.at(1).toString(), QString("two"));
+        QCOMPARE(array.at(2).toMap().value("three").toInt(), 3);
+
+        // These are no JSON texts, and are evaluated as scripts.
+        QCOMPARE(dataModel->scxmlProperty("sequence").toInt(), 2);
+        QCOMPARE(dataModel->scxmlProperty("reference").toInt(), 43);
+    }
+}
+
+void tst_StateMachine::typedEventData()
+{
+    QScxmlEvent event;
+    event.setName("reading");
+    QVERIFY(!event.typedData<Reading>());
+
+    event.setData(QVariant::fromValue(Reading{ 21.5, 42, QStringLiteral("C") }));
+    const Reading *reading = event.typedData<Reading>();
+    QVERIFY(reading);
+    QCOMPARE(reading->value, 21.5);
+    QCOMPARE(reading->timestamp, 42);
+    QCOMPARE(reading->unit, QStringLiteral("C"));
+    QVERIFY(!event.typedData<int>());
+
+    // The payload is read in place, not copied.
+    QCOMPARE(event.typedData<Reading>(), reading);
+    const QScxmlEvent copy(event);
+    QCOMPARE(copy.typedData<Reading>()->unit, QStringLiteral("C"));
+
+    // Error events don't expose their message as payload.
+    QScxmlEvent error;
+    error.setEventType(QScxmlEvent::PlatformEvent);
+    error.setName("error.execution");
+    error.setErrorMessage("oops");
+    QVERIFY(!error.typedData<QString>());
+}
+
+void tst_StateMachine::binaryTrace()
+{
+    QScxmlInternal::Trace::clear();
+    QScxmlInternal::Trace::setEnabled(true);
+    {
+        QScopedPointer<QScxmlStateMachine> stateMachine(
+                    QScxmlStateMachine::fromFile(QString(":/tst_statemachine/stateDotDoneEvent.scxml")));
+        QVERIFY(!stateMachine.isNull());
+        QSignalSpy finishedSpy(stateMachine.data(), SIGNAL(finished()));
+        stateMachine->start();
+        QTRY_COMPARE(finishedSpy.count(), 1);
+    }
+    QScxmlInternal::Trace::setEnabled(false);
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    QVERIFY(QScxmlInternal::Trace::writeChromeTrace(&buffer));
+
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(buffer.data(), &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    QSet<QString> events;
+    const QJsonArray traceEvents = document.object().value("traceEvents").toArray();
+    for (const QJsonValue &value : traceEvents) {
+        const QJsonObject event = value.toObject();
+        events.insert(event.value("ph").toString() + QLatin1Char(' ')
+                      + event.value("name").toString());
+    }
+
+    QVERIFY(events.contains("B macrostep"));
+    QVERIFY(events.contains("E macrostep"));
+    QVERIFY(events.contains("B microstep"));
+    QVERIFY(events.contains("i terminate"));
+    QVERIFY(events.contains("i a1 -> a2"));
+    QVERIFY(events.contains("b a1"));
+    QVERIFY(events.contains("e a1"));
+    QVERIFY(events.contains("b success"));
+    QVERIFY(events.contains("X guard"));
+    QVERIFY(!events.contains("b failure"));
+
+    // Invoke ids are not interned, as generated ones are unique per session.
+    using QScxmlInternal::Trace;
+    const quint32 doneInvoke = Trace::eventNameId("done.invoke.s1.session-1");
+    QVERIFY(doneInvoke != 0);
+    QCOMPARE(Trace::eventNameId("done.invoke.s1.session-2"), doneInvoke);
+    QVERIFY(Trace::eventNameId("done.invoked") != doneInvoke);
+}
+
+void tst_StateMachine::traceBuffers()
+{
+    using QScxmlInternal::Trace;
+    using QScxmlInternal::TraceRecord;
+
+    const auto tracedStates = [] {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        Trace::writeChromeTrace(&buffer);
+        QStringList states;
+        const QJsonArray traceEvents = QJsonDocument::fromJson(buffer.data()).object()
+                .value("traceEvents").toArray();
+        for (const QJsonValue &value : traceEvents) {
+            const QJsonObject event = value.toObject();
+            if (event.value("cat").toString() == QLatin1String("state"))
+                states.append(event.value("name").toString());
+        }
+        return states;
+    };
+
+    Trace::setEnabled(true);
+    const quint32 machine = Trace::registerMachine("traceBuffers", "session", { "s0", "s1" },
+                                                   {});
+    Trace::record(machine, TraceRecord::StateEntered, 0);
+    Trace::clear();
+    QVERIFY(tracedStates().isEmpty());
+
+    // A thread that has exited hands its buffer on, but its records are kept.
+    for (int i = 0; i != 2; ++i) {
+        QScopedPointer<QThread> thread(QThread::create([machine, i] {
+            Trace::record(machine, TraceRecord::StateEntered, i);
+        }));
+        thread->start();
+        QVERIFY(thread->wait());
+    }
+    QCOMPARE(tracedStates(), QStringList({ "s0", "s1" }));
+
+    // A full buffer drops its oldest records.
+    Trace::clear();
+    for (int i = 0; i != Trace::BufferSize + 1; ++i)
+        Trace::record(machine, TraceRecord::StateExited, i % 2);
+    QCOMPARE(tracedStates().size(), Trace::BufferSize - 1);
+    Trace::setEnabled(false);
+    Trace::clear();
+}
+
 void tst_StateMachine::logWithoutExpr()
 {
     QScopedPointer<QScxmlStateMachine> stateMachine(
@@ -499,6 +746,24 @@ void tst_StateMachine::bindings()
         return;
     }
 
+    // -- QScxmlStateMachine::externalQueueCapacity
+    QTestPrivate::testReadWritePropertyBasics<QScxmlStateMachine, int>(
+                *stateMachine1, 4, 8, "externalQueueCapacity");
+    if (QTest::currentTestFailed()) {
+        qWarning() << "QScxmlStateMachine::externalQueueCapacity bindable test failed.";
+        return;
+    }
+
+    // -- QScxmlStateMachine::queueOverflowPolicy
+    QTestPrivate::testReadWritePropertyBasics<QScxmlStateMachine,
+                                              QScxmlStateMachine::QueueOverflowPolicy>(
+                *stateMachine1, QScxmlStateMachine::DropOldestEvent,
+                QScxmlStateMachine::BlockSender, "queueOverflowPolicy");
+    if (QTest::currentTestFailed()) {
+        qWarning() << "QScxmlStateMachine::queueOverflowPolicy bindable test failed.";
+        return;
+    }
+
     // -- QScxmlStateMachine::dataModel
     // Use non-existent file below, as valid file would initialize the model
     std::unique_ptr<QScxmlStateMachine> stateMachine2(
@@ -561,6 +826,365 @@ void tst_StateMachine::bindings()
     }
 }
 
+void tst_StateMachine::snapshot()
+{
+    QBuffer buffer;
+    {
+        QScopedPointer<QScxmlStateMachine> stateMachine(
+                    QScxmlStateMachine::fromFile(QString(":/tst_statemachine/snapshot.scxml")));
+        QVERIFY(!stateMachine.isNull());
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(!stateMachine->saveSnapshot(&buffer)); // not initialized yet
+
+        stateMachine->start();
+        QTRY_VERIFY(stateMachine->isActive(QStringLiteral("a")));
+        stateMachine->submitEvent(QStringLiteral("next"));
+        stateMachine->submitEvent(QStringLiteral("pause"));
+        QTRY_VERIFY(stateMachine->isActive(QStringLiteral("paused")));
+
+        // Still queued when the snapshot is taken, while "wake" is still delayed.
+        stateMachine->submitEvent(QStringLiteral("ping"));
+        buffer.seek(0);
+        QVERIFY(stateMachine->saveSnapshot(&buffer));
+        buffer.close();
+    }
+
+    QScopedPointer<QScxmlStateMachine> restored(
+                QScxmlStateMachine::fromFile(QString(":/tst_statemachine/snapshot.scxml")));
+    QVERIFY(!restored.isNull());
+    QSignalSpy runningSpy(restored.data(), SIGNAL(runningChanged(bool)));
+    buffer.open(QIODevice::ReadOnly);
+    QVERIFY(restored->restoreSnapshot(&buffer));
+    buffer.close();
+
+    QVERIFY(restored->isRunning());
+    QCOMPARE(runningSpy.count(), 1);
+    QCOMPARE(restored->activeStateNames(), QStringList(QStringLiteral("paused")));
+    QCOMPARE(restored->dataModel()->scxmlProperty(QStringLiteral("counter")).toInt(), 1);
+
+    // The queued event is processed, and the delayed one leads back through the history.
+    QTRY_COMPARE(restored->dataModel()->scxmlProperty(QStringLiteral("counter")).toInt(), 11);
+    QTRY_VERIFY(restored->isActive(QStringLiteral("b")));
+
+    // A running state machine cannot be overwritten.
+    buffer.open(QIODevice::ReadOnly);
+    QVERIFY(!restored->restoreSnapshot(&buffer));
+    buffer.close();
+
+    QScopedPointer<QScxmlStateMachine> other(
+                QScxmlStateMachine::fromFile(QString(":/tst_statemachine/stateDotDoneEvent.scxml")));
+    QVERIFY(!other.isNull());
+    buffer.open(QIODevice::ReadOnly);
+    QVERIFY(!other->restoreSnapshot(&buffer));
+    buffer.close();
+    QVERIFY(!other->isRunning());
+
+    QBuffer garbage;
+    garbage.setData("not a snapshot");
+    garbage.open(QIODevice::ReadOnly);
+    QVERIFY(!other->restoreSnapshot(&garbage));
+}
+
+void tst_StateMachine::snapshotWithInvokedChild()
+{
+    const auto childOf = [](QScxmlStateMachine *stateMachine) {
+        const QList<QScxmlInvokableService *> services = stateMachine->invokedServices();
+        return services.size() == 1
+                ? qvariant_cast<QScxmlStateMachine *>(services.first()->property("stateMachine"))
+                : nullptr;
+    };
+
+    QBuffer buffer;
+    QString childId;
+    {
+        QScopedPointer<QScxmlStateMachine> stateMachine(
+                    QScxmlStateMachine::fromFile(QString(":/tst_statemachine/snapshotinvoke.scxml")));
+        QVERIFY(!stateMachine.isNull());
+        stateMachine->start();
+        QTRY_VERIFY(childOf(stateMachine.data()));
+        QScxmlStateMachine *child = childOf(stateMachine.data());
+        childId = child->sessionId();
+        QCOMPARE(stateMachine->dataModel()->scxmlProperty("childId").toString(), childId);
+
+        stateMachine->submitEvent("poke");
+        QTRY_COMPARE(child->dataModel()->scxmlProperty("count").toInt(), 1);
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(stateMachine->saveSnapshot(&buffer));
+        buffer.close();
+    }
+
+    QScopedPointer<QScxmlStateMachine> restored(
+                QScxmlStateMachine::fromFile(QString(":/tst_statemachine/snapshotinvoke.scxml")));
+    QVERIFY(!restored.isNull());
+    buffer.open(QIODevice::ReadOnly);
+    QVERIFY(restored->restoreSnapshot(&buffer));
+    buffer.close();
+
+    // The child keeps its id and its data, rather than being set up again.
+    QScxmlStateMachine *child = childOf(restored.data());
+    QVERIFY(child);
+    QCOMPARE(child->sessionId(), childId);
+    QCOMPARE(restored->invokedServices().first()->id(), childId);
+    QCOMPARE(child->dataModel()->scxmlProperty("count").toInt(), 1);
+    QCOMPARE(child->activeStateNames(), QStringList(QStringLiteral("counting")));
+
+    // The parent still reaches the child through the saved id, and gets its done.invoke event.
+    restored->submitEvent("poke");
+    QTRY_VERIFY(restored->isActive(QStringLiteral("finished")));
+}
+
+void tst_StateMachine::eventLog()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath(QStringLiteral("snapshot.scxmllog"));
+    {
+        QScopedPointer<QScxmlStateMachine> stateMachine(
+                    QScxmlStateMachine::fromFile(QString(":/tst_statemachine/snapshot.scxml")));
+        QVERIFY(!stateMachine.isNull());
+        QVERIFY(QScxmlInternal::EventLog::startRecording(stateMachine.data(), fileName));
+
+        stateMachine->start();
+        QTRY_VERIFY(stateMachine->isActive(QStringLiteral("a")));
+        stateMachine->submitEvent(QStringLiteral("next"));
+        stateMachine->submitEvent(QStringLiteral("pause"));
+        stateMachine->submitEvent(QStringLiteral("ping"));
+        QTRY_VERIFY(stateMachine->isActive(QStringLiteral("paused")));
+        // "wake" is sent with a delay, and its firing is recorded as well.
+        QTRY_VERIFY(stateMachine->isActive(QStringLiteral("b")));
+        QCOMPARE(stateMachine->dataModel()->scxmlProperty(QStringLiteral("counter")).toInt(), 11);
+        QScxmlInternal::EventLog::stopRecording(stateMachine.data());
+    }
+
+    QScopedPointer<QScxmlStateMachine> replayed(
+                QScxmlStateMachine::fromFile(QString(":/tst_statemachine/snapshot.scxml")));
+    QVERIFY(!replayed.isNull());
+    QVERIFY(QScxmlInternal::EventLog::replay(replayed.data(), fileName));
+
+    // The replay does not wait for the delay of "wake".
+    QVERIFY(replayed->isActive(QStringLiteral("b")));
+    QCOMPARE(replayed->dataModel()->scxmlProperty(QStringLiteral("counter")).toInt(), 11);
+
+    QScopedPointer<QScxmlStateMachine> other(
+                QScxmlStateMachine::fromFile(QString(":/tst_statemachine/stateDotDoneEvent.scxml")));
+    QVERIFY(!other.isNull());
+    QVERIFY(!QScxmlInternal::EventLog::replay(other.data(), fileName));
+}
+
+void tst_StateMachine::virtualClock()
+{
+    QScopedPointer<QScxmlStateMachine> stateMachine(
+                QScxmlStateMachine::fromFile(QString(":/tst_statemachine/clock.scxml")));
+    QVERIFY(!stateMachine.isNull());
+
+    QScxmlInternal::VirtualClock clock;
+    QScxmlInternal::Clock::setClock(stateMachine.data(), &clock);
+    QVERIFY(QScxmlInternal::Clock::clock(stateMachine.data()) == &clock);
+    QCOMPARE(clock.nextDueTime(), qint64(-1));
+
+    const auto log = [&]() {
+        return stateMachine->dataModel()->scxmlProperty(QStringLiteral("log")).toString();
+    };
+
+    stateMachine->start();
+    clock.advance(3600 * 1000 - 1);
+    QVERIFY(stateMachine->isActive(QStringLiteral("waiting")));
+    QCOMPARE(log(), QString());
+    QCOMPARE(clock.currentTime(), qint64(3600 * 1000 - 1));
+    QCOMPARE(clock.nextDueTime(), qint64(3600 * 1000));
+
+    // Events due at the same time arrive in the order they were sent.
+    clock.advance(1);
+    QCOMPARE(log(), QStringLiteral("early,sameTime,"));
+    QCOMPARE(clock.nextDueTime(), qint64(5400 * 1000));
+
+    while (clock.advanceToNext()) {}
+    QCOMPARE(log(), QStringLiteral("early,sameTime,chained,late"));
+    QVERIFY(!stateMachine->isRunning());
+    QCOMPARE(clock.currentTime(), qint64(7200 * 1000));
+    QCOMPARE(clock.nextDueTime(), qint64(-1));
+}
+
+void tst_StateMachine::boundedQueue()
+{
+    QScopedPointer<QScxmlStateMachine> stateMachine(
+                QScxmlStateMachine::fromFile(QString(":/tst_statemachine/queue.scxml")));
+    QVERIFY(!stateMachine.isNull());
+    QCOMPARE(stateMachine->externalQueueCapacity(), 0);
+    QCOMPARE(stateMachine->queueOverflowPolicy(), QScxmlStateMachine::RejectEvent);
+    stateMachine->setExternalQueueCapacity(2);
+
+    QSignalSpy congestedSpy(stateMachine.data(),
+                            &QScxmlStateMachine::externalQueueCongestedChanged);
+    stateMachine->start();
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("idle")));
+
+    const auto submit = [&](const QString &name) {
+        QScxmlEvent *event = new QScxmlEvent;
+        event->setName(name);
+        return stateMachine->trySubmitEvent(event);
+    };
+    const auto property = [&](const QString &name) {
+        return stateMachine->dataModel()->scxmlProperty(name);
+    };
+
+    // The events stay queued until control returns to the event loop.
+    QCOMPARE(submit(QStringLiteral("tick.1")), QScxmlStateMachine::EventAccepted);
+    QVERIFY(!stateMachine->isExternalQueueCongested());
+    QCOMPARE(submit(QStringLiteral("tick.2")), QScxmlStateMachine::EventAccepted);
+    QVERIFY(stateMachine->isExternalQueueCongested());
+    QCOMPARE(submit(QStringLiteral("tick.3")), QScxmlStateMachine::EventRejected);
+
+    QTRY_COMPARE(property(QStringLiteral("ticks")).toString(), QStringLiteral("tick.1,tick.2,"));
+    QCOMPARE(property(QStringLiteral("errors")).toInt(), 1);
+    QVERIFY(!stateMachine->isExternalQueueCongested());
+    QCOMPARE(congestedSpy.count(), 2);
+
+    stateMachine->setQueueOverflowPolicy(QScxmlStateMachine::DropOldestEvent);
+    QCOMPARE(submit(QStringLiteral("tick.4")), QScxmlStateMachine::EventAccepted);
+    QCOMPARE(submit(QStringLiteral("tick.5")), QScxmlStateMachine::EventAccepted);
+    QCOMPARE(submit(QStringLiteral("tick.6")), QScxmlStateMachine::OldestEventDropped);
+    QTRY_COMPARE(property(QStringLiteral("ticks")).toString(),
+                 QStringLiteral("tick.1,tick.2,tick.5,tick.6,"));
+    QCOMPARE(property(QStringLiteral("errors")).toInt(), 1);
+
+    // Without a capacity, the queue takes everything.
+    stateMachine->setExternalQueueCapacity(0);
+    for (int i = 7; i < 10; ++i)
+        QCOMPARE(submit(QStringLiteral("tick.%1").arg(i)), QScxmlStateMachine::EventAccepted);
+    QVERIFY(!stateMachine->isExternalQueueCongested());
+    QTRY_COMPARE(property(QStringLiteral("ticks")).toString(),
+                 QStringLiteral("tick.1,tick.2,tick.5,tick.6,tick.7,tick.8,tick.9,"));
+}
+
+void tst_StateMachine::mutuallyBlockingSenders()
+{
+    using QScxmlInternal::EventChannel;
+
+    QScopedPointer<QScxmlStateMachine> a(
+                QScxmlStateMachine::fromFile(QString(":/tst_statemachine/queue.scxml")));
+    QScopedPointer<QScxmlStateMachine> b(
+                QScxmlStateMachine::fromFile(QString(":/tst_statemachine/queue.scxml")));
+    QVERIFY(!a.isNull());
+    QVERIFY(!b.isNull());
+    for (QScxmlStateMachine *stateMachine : { a.data(), b.data() }) {
+        stateMachine->setExternalQueueCapacity(1);
+        stateMachine->setQueueOverflowPolicy(QScxmlStateMachine::BlockSender);
+    }
+    a->start();
+    QTRY_VERIFY(a->isActive(QStringLiteral("idle")));
+
+    QThread thread;
+    thread.start();
+    QScxmlStateMachinePrivate::get(b.data())->moveToThread(&thread);
+    const auto onThread = [&](auto function) {
+        QMetaObject::invokeMethod(b.data(), function, Qt::BlockingQueuedConnection);
+    };
+    onThread([&] { b->start(); });
+
+    const auto channelToA = std::make_shared<EventChannel>(a.data());
+    const auto channelToB = std::make_shared<EventChannel>(b.data());
+    const auto tick = [](int i) {
+        QScxmlEvent *event = new QScxmlEvent;
+        event->setName(QStringLiteral("tick.%1").arg(i));
+        return event;
+    };
+
+    // While this thread does not return to the event loop, b fills a's queue and waits for room.
+    QMetaObject::invokeMethod(b.data(), [&] {
+        for (int i = 1; i <= 3; ++i)
+            channelToA->send(tick(i), b.data());
+    }, Qt::QueuedConnection);
+    const QAtomicInt &waitingForA = QScxmlStateMachinePrivate::get(a.data())->m_waitingSenders;
+    QDeadlineTimer deadline(SpyWaitTime);
+    while (waitingForA.loadRelaxed() == 0 && !deadline.hasExpired())
+        QThread::yieldCurrentThread();
+    QCOMPARE(waitingForA.loadRelaxed(), 1);
+
+    // a fills b's queue in turn, but doesn't wait for b, which is waiting for a.
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 1; i <= 3; ++i)
+        QVERIFY(channelToB->send(tick(i), a.data()));
+    QVERIFY(timer.elapsed() < EventChannel::MaxSendWait);
+
+    // Nothing is lost, and the queues never hold more than their capacity.
+    const QString ticks = QStringLiteral("tick.1,tick.2,tick.3,");
+    QTRY_COMPARE(a->dataModel()->scxmlProperty("ticks").toString(), ticks);
+    QCOMPARE(a->dataModel()->scxmlProperty("errors").toInt(), 0);
+    QTRY_VERIFY_WITH_TIMEOUT([&] {
+        QString received;
+        onThread([&] { received = b->dataModel()->scxmlProperty("ticks").toString(); });
+        return received == ticks;
+    }(), SpyWaitTime);
+    auto info = new QScxmlStateMachineInfo(a.data());
+    QVERIFY(info->metrics().externalQueueHighWater <= 1);
+
+    channelToA->close();
+    channelToB->close();
+    onThread([&] { QScxmlStateMachinePrivate::get(b.data())->moveToThread(a->thread()); });
+    thread.quit();
+    QVERIFY(thread.wait());
+}
+
+void tst_StateMachine::coalescingAndPriorities()
+{
+    QScopedPointer<QScxmlStateMachine> stateMachine(
+                QScxmlStateMachine::fromFile(QString(":/tst_statemachine/queue.scxml")));
+    QVERIFY(!stateMachine.isNull());
+    stateMachine->setEventCoalescing(QStringLiteral("pos"), true, QStringLiteral("id"));
+    stateMachine->setEventPriority(QStringLiteral("tick.urgent.*"),
+                                   QScxmlStateMachine::HighPriority);
+    stateMachine->setExternalQueueCapacity(3);
+
+    stateMachine->start();
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("idle")));
+
+    const auto submit = [&](const QString &name, const QVariant &data = QVariant()) {
+        QScxmlEvent *event = new QScxmlEvent;
+        event->setName(name);
+        event->setData(data);
+        return stateMachine->trySubmitEvent(event);
+    };
+    const auto pos = [](int id, int value) {
+        return QVariantMap({{ QStringLiteral("id"), id }, { QStringLiteral("value"), value }});
+    };
+
+    QCOMPARE(submit(QStringLiteral("pos"), pos(1, 10)), QScxmlStateMachine::EventAccepted);
+    QCOMPARE(submit(QStringLiteral("pos"), pos(2, 20)), QScxmlStateMachine::EventAccepted);
+    QCOMPARE(submit(QStringLiteral("tick.normal")), QScxmlStateMachine::EventAccepted);
+    // The queue is full, but the update takes the place of the pending one.
+    QCOMPARE(submit(QStringLiteral("pos"), pos(1, 11)), QScxmlStateMachine::EventCoalesced);
+    QCOMPARE(submit(QStringLiteral("pos"), pos(1, 12)), QScxmlStateMachine::EventCoalesced);
+    stateMachine->setExternalQueueCapacity(0);
+    QCOMPARE(submit(QStringLiteral("tick.urgent")), QScxmlStateMachine::EventAccepted);
+
+    QTRY_COMPARE(stateMachine->dataModel()->scxmlProperty(QStringLiteral("ticks")).toString(),
+                 QStringLiteral("tick.urgent,pos1=12,pos2=20,tick.normal,"));
+
+    // Once the pending event is processed, the next one is queued again.
+    QCOMPARE(submit(QStringLiteral("pos"), pos(1, 13)), QScxmlStateMachine::EventAccepted);
+    QTRY_COMPARE(stateMachine->dataModel()->scxmlProperty(QStringLiteral("ticks")).toString(),
+                 QStringLiteral("tick.urgent,pos1=12,pos2=20,tick.normal,pos1=13,"));
+}
+
+void tst_StateMachine::duplicateDescriptors()
+{
+    QScopedPointer<QScxmlStateMachine> stateMachine(
+                QScxmlStateMachine::fromFile(
+                    QString(":/tst_statemachine/duplicatedescriptors.scxml")));
+    QVERIFY(!stateMachine.isNull());
+
+    stateMachine->start();
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("waiting")));
+    stateMachine->submitEvent(QStringLiteral("foo"));
+    stateMachine->submitEvent(QStringLiteral("check"));
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("checked")));
+
+    // The failing guard is evaluated once, although both descriptors match.
+    QCOMPARE(stateMachine->dataModel()->scxmlProperty(QStringLiteral("errors")).toInt(), 1);
+}
+
 QTEST_MAIN(tst_StateMachine)
 
 #include "tst_statemachine.moc"
@@ -36,6 +36,10 @@ class tst_StateMachineInfo: public QObject
 
 private Q_SLOTS:
     void checkInfo();
+    void deadTransitions();
+    void keptConditions();
+    void metrics();
+    void profile();
 };
 
 class Recorder: public QObject
@@ -228,6 +232,182 @@ void tst_StateMachineInfo::checkInfo()
 }
 
 
+void tst_StateMachineInfo::deadTransitions()
+{
+    QScopedPointer<QScxmlStateMachine> stateMachine(
+                QScxmlStateMachine::fromFile(
+                    QString(":/tst_statemachineinfo/deadtransitions.scxml")));
+    QVERIFY(!stateMachine.isNull());
+    QVERIFY(stateMachine->parseErrors().isEmpty());
+    auto info = new QScxmlStateMachineInfo(stateMachine.data());
+
+    // states are never optimized away
+    const auto states = info->allStates();
+    QCOMPARE(states.size(), 3);
+
+    // only a's "go" and "stay" transitions, and the initial transition remain
+    const auto transitions = info->allTransitions();
+    QCOMPARE(transitions.size(), 3);
+
+    QCOMPARE(info->transitionSource(transitions.at(0)), states.at(0));
+    QCOMPARE(info->transitionEvents(transitions.at(0)), QStringList(QStringLiteral("go")));
+    QCOMPARE(info->transitionTargets(transitions.at(0)), QList<int>() << states.at(1));
+
+    QCOMPARE(info->transitionSource(transitions.at(1)), states.at(0));
+    QCOMPARE(info->transitionEvents(transitions.at(1)), QStringList(QStringLiteral("stay")));
+
+    QCOMPARE(info->transitionType(transitions.at(2)), QScxmlStateMachineInfo::SyntheticTransition);
+
+    stateMachine->start();
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("a")));
+    stateMachine->submitEvent(QStringLiteral("stay"));
+    stateMachine->submitEvent(QStringLiteral("go"));
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("b")));
+}
+
+void tst_StateMachineInfo::keptConditions()
+{
+    QScopedPointer<QScxmlStateMachine> stateMachine(
+                QScxmlStateMachine::fromFile(
+                    QString(":/tst_statemachineinfo/keptconditions.scxml")));
+    QVERIFY(!stateMachine.isNull());
+    QVERIFY(stateMachine->parseErrors().isEmpty());
+    auto info = new QScxmlStateMachineInfo(stateMachine.data());
+
+    // conditions on initial and history transitions are never used to drop them
+    QCOMPARE(info->allTransitions().size(), 5);
+
+    stateMachine->start();
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("q")));
+    stateMachine->submitEvent(QStringLiteral("leave"));
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("out")));
+    stateMachine->submitEvent(QStringLiteral("back"));
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("q")));
+}
+
+void tst_StateMachineInfo::metrics()
+{
+    QScopedPointer<QScxmlStateMachine> stateMachine(
+                QScxmlStateMachine::fromFile(QString(":/tst_statemachineinfo/metrics.scxml")));
+    QVERIFY(!stateMachine.isNull());
+    QVERIFY(stateMachine->parseErrors().isEmpty());
+    auto info = new QScxmlStateMachineInfo(stateMachine.data());
+    info->setTimingEnabled(true);
+    QVERIFY(info->isTimingEnabled());
+
+    QScxmlStateMachineInfo::StateId idle = QScxmlStateMachineInfo::InvalidStateId;
+    for (auto state : info->allStates()) {
+        if (info->stateName(state) == QLatin1String("idle"))
+            idle = state;
+    }
+    QVERIFY(idle != QScxmlStateMachineInfo::InvalidStateId);
+
+    stateMachine->start();
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("idle")));
+    stateMachine->submitEvent(QStringLiteral("go"));
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("done")));
+
+    auto metrics = info->metrics();
+    QCOMPARE(metrics.externalEventsProcessed, 1u);
+    // "next", and the error.execution caused by the second guard on "go"
+    QCOMPARE(metrics.internalEventsProcessed, 2u);
+    QCOMPARE(metrics.internalQueueHighWater, 2);
+    QCOMPARE(metrics.externalQueueHighWater, 1);
+    QCOMPARE(metrics.delayedEventsPending, 1);
+    QCOMPARE(metrics.guardEvaluations, 2u);
+    QCOMPARE(metrics.guardRejections, 1u);
+    QCOMPARE(metrics.guardErrors, 1u);
+    QCOMPARE(metrics.microsteps, 2u);
+
+    QCOMPARE(metrics.microstepsPerMacrostep.size(), 8);
+    quint64 macrosteps = 0;
+    for (quint64 count : metrics.microstepsPerMacrostep)
+        macrosteps += count;
+    QCOMPARE(macrosteps, metrics.macrosteps);
+    QCOMPARE(metrics.microstepsPerMacrostep.at(2), 1u); // "go" and "next" in one macrostep
+
+    QCOMPARE(metrics.executableContentTime.size(), info->allStates().size());
+    QVERIFY(metrics.executableContentTime.at(idle) > 0);
+
+    // Resetting and reading the metrics is allowed from other threads.
+    QScopedPointer<QThread> thread(QThread::create([&] {
+        info->resetMetrics();
+        metrics = info->metrics();
+    }));
+    thread->start();
+    QVERIFY(thread->wait());
+    QCOMPARE(metrics.externalEventsProcessed, 0u);
+    QCOMPARE(metrics.internalEventsProcessed, 0u);
+    QCOMPARE(metrics.macrosteps, 0u);
+    QCOMPARE(metrics.guardEvaluations, 0u);
+    QCOMPARE(metrics.internalQueueHighWater, 0);
+    QCOMPARE(metrics.executableContentTime.at(idle), 0u);
+    QCOMPARE(metrics.delayedEventsPending, 1);
+}
+
+void tst_StateMachineInfo::profile()
+{
+    QScopedPointer<QScxmlStateMachine> stateMachine(
+                QScxmlStateMachine::fromFile(QString(":/tst_statemachineinfo/metrics.scxml")));
+    QVERIFY(!stateMachine.isNull());
+    QVERIFY(stateMachine->parseErrors().isEmpty());
+    auto info = new QScxmlStateMachineInfo(stateMachine.data());
+    QVERIFY(!info->isProfilingEnabled());
+    QVERIFY(!info->profile().contains(QStringLiteral("states")));
+    info->setProfilingEnabled(true);
+    QVERIFY(info->isProfilingEnabled());
+
+    stateMachine->start();
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("idle")));
+    stateMachine->submitEvent(QStringLiteral("go"));
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("done")));
+
+    QHash<QString, QScxmlStateMachineInfo::StateId> ids;
+    for (auto state : info->allStates())
+        ids.insert(info->stateName(state), state);
+
+    QJsonObject profile = info->profile();
+    QCOMPARE(profile.value(QStringLiteral("name")).toString(), QStringLiteral("MetricsTest"));
+    QJsonArray states = profile.value(QStringLiteral("states")).toArray();
+    QCOMPARE(states.size(), info->allStates().size());
+    for (const QString &name : { QStringLiteral("idle"), QStringLiteral("busy"),
+                                 QStringLiteral("done") }) {
+        const QJsonObject state = states.at(ids.value(name)).toObject();
+        QCOMPARE(state.value(QStringLiteral("name")).toString(), name);
+        QCOMPARE(state.value(QStringLiteral("entries")).toInteger(), 1);
+        QCOMPARE(state.value(QStringLiteral("active")).toBool(), name == QLatin1String("done"));
+    }
+    QVERIFY(states.at(ids.value(QStringLiteral("idle"))).toObject()
+            .value(QStringLiteral("dwellTime")).toInteger() > 0);
+
+    QList<QJsonObject> fromIdle;
+    const QJsonArray transitions = profile.value(QStringLiteral("transitions")).toArray();
+    QCOMPARE(transitions.size(), info->allTransitions().size());
+    for (const auto &transition : transitions) {
+        if (transition.toObject().value(QStringLiteral("source")).toInt()
+                == ids.value(QStringLiteral("idle"))) {
+            fromIdle.append(transition.toObject());
+        }
+    }
+    QCOMPARE(fromIdle.size(), 3);
+    QCOMPARE(fromIdle.at(0).value(QStringLiteral("rejected")).toInteger(), 1);
+    QCOMPARE(fromIdle.at(0).value(QStringLiteral("taken")).toInteger(), 0);
+    QCOMPARE(fromIdle.at(1).value(QStringLiteral("rejected")).toInteger(), 1);
+    QCOMPARE(fromIdle.at(2).value(QStringLiteral("rejected")).toInteger(), 0);
+    QCOMPARE(fromIdle.at(2).value(QStringLiteral("taken")).toInteger(), 1);
+
+    info->resetProfile();
+    profile = info->profile();
+    states = profile.value(QStringLiteral("states")).toArray();
+    QCOMPARE(states.at(ids.value(QStringLiteral("idle"))).toObject()
+             .value(QStringLiteral("entries")).toInteger(), 0);
+    QVERIFY(states.at(ids.value(QStringLiteral("done"))).toObject()
+            .value(QStringLiteral("active")).toBool());
+
+    info->setProfilingEnabled(false);
+    QVERIFY(!info->profile().contains(QStringLiteral("states")));
+}
+
 QTEST_MAIN(tst_StateMachineInfo)
 
 #include "tst_statemachineinfo.moc"
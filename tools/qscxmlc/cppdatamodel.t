@@ -1,7 +1,17 @@
+${evaluators}${evaluatorArrays}const QScxmlCppDataModel::EvaluatorTable ${datamodel}::qt_scxmlEvaluators = {
+${evaluatorTableEntries}
+};
+
+const QScxmlCppDataModel::EvaluatorTable *${datamodel}::evaluatorTable() const
+{ return &qt_scxmlEvaluators; }
+
 QString ${datamodel}::evaluateToString(QScxmlExecutableContent::EvaluatorId id, bool *ok)
 {
-    *ok = true;
-${evaluateToStringCases}
+    const QScxmlCppDataModel::EvaluatorTable &evaluators = qt_scxmlEvaluators;
+    if (id >= 0 && id < evaluators.stringEvaluatorCount && evaluators.stringEvaluators[id]) {
+        *ok = true;
+        return (this->*evaluators.stringEvaluators[id])();
+    }
     Q_UNREACHABLE();
     *ok = false;
     return QString();
@@ -9,8 +19,11 @@ ${evaluateToStringCases}
 
 bool ${datamodel}::evaluateToBool(QScxmlExecutableContent::EvaluatorId id, bool *ok)
 {
-    *ok = true;
-${evaluateToBoolCases}
+    const QScxmlCppDataModel::EvaluatorTable &evaluators = qt_scxmlEvaluators;
+    if (id >= 0 && id < evaluators.boolEvaluatorCount && evaluators.boolEvaluators[id]) {
+        *ok = true;
+        return (this->*evaluators.boolEvaluators[id])();
+    }
     Q_UNREACHABLE();
     *ok = false;
     return false;
@@ -18,8 +31,11 @@ ${evaluateToBoolCases}
 
 QVariant ${datamodel}::evaluateToVariant(QScxmlExecutableContent::EvaluatorId id, bool *ok)
 {
-    *ok = true;
-${evaluateToVariantCases}
+    const QScxmlCppDataModel::EvaluatorTable &evaluators = qt_scxmlEvaluators;
+    if (id >= 0 && id < evaluators.variantEvaluatorCount && evaluators.variantEvaluators[id]) {
+        *ok = true;
+        return (this->*evaluators.variantEvaluators[id])();
+    }
     Q_UNREACHABLE();
     *ok = false;
     return QVariant();
@@ -27,8 +43,12 @@ ${evaluateToVariantCases}
 
 void ${datamodel}::evaluateToVoid(QScxmlExecutableContent::EvaluatorId id, bool *ok)
 {
-    *ok = true;
-${evaluateToVoidCases}
+    const QScxmlCppDataModel::EvaluatorTable &evaluators = qt_scxmlEvaluators;
+    if (id >= 0 && id < evaluators.voidEvaluatorCount && evaluators.voidEvaluators[id]) {
+        *ok = true;
+        (this->*evaluators.voidEvaluators[id])();
+        return;
+    }
     Q_UNREACHABLE();
     *ok = false;
 }
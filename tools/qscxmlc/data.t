@@ -5,6 +5,7 @@ struct ${classname}::Data: private QScxmlTableData {
 
     void init() {
         stateMachine.setTableData(this);
+        stateMachine.setStaticTables(&staticTables);
         ${dataModelInitialization}
     }
 
@@ -87,6 +88,7 @@ struct ${classname}::Data: private QScxmlTableData {
         const uint offsetsAndSize[${stringCount} * 2];
         char16_t stringdata[${stringdataSize}];
     } strings;
+    static const QScxmlTableData::StaticTables staticTables;
 };
 
 ${classname}::${classname}(QObject *parent)
@@ -130,4 +132,20 @@ ${uniLits}
 
 const qint32 ${classname}::Data::theStateMachineTable[] = ${theStateMachineTable};
 
+const QScxmlTableData::StaticTables ${classname}::Data::staticTables = {
+    theInstructions,
+    evaluators,
+    ${evaluatorCount},
+    assignments,
+    ${assignmentCount},
+    foreaches,
+    ${foreachCount},
+    dataIds,
+    ${dataNameCount},
+    theStateMachineTable,
+    strings.offsetsAndSize,
+    strings.stringdata,
+    ${stringCount}
+};
+
 ${metaObject}
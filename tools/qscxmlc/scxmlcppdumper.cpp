@@ -294,71 +294,67 @@ void generateTables(const GeneratedTableData &td, Replacements &replacements)
     }
 }
 
-void generateCppDataModelEvaluators(const GeneratedTableData::DataModelInfo &info,
-                                    Replacements &replacements)
+void generateCppDataModelEvaluatorTable(
+        const QHash<QScxmlExecutableContent::EvaluatorId, QString> &evaluators,
+        const QString &dataModel, const QString &type, const QString &kind,
+        QString &definitions, QString &arrays, QString &entries)
 {
-    const QString switchStart = QStringLiteral("    switch (id) {\n");
-    const QString switchEnd = QStringLiteral("    default: break;\n    }");
-    const QString unusedId = QStringLiteral("    Q_UNUSED(id);");
-    QString stringEvals;
-    if (!info.stringEvaluators.isEmpty()) {
-        stringEvals += switchStart;
-        for (auto it = info.stringEvaluators.constBegin(), eit = info.stringEvaluators.constEnd();
-             it != eit; ++it) {
-            stringEvals += QStringLiteral("    case %1:\n").arg(it.key());
-            stringEvals += QStringLiteral("        return [this]()->QString{ return %1; }();\n")
-                    .arg(it.value());
-        }
-        stringEvals += switchEnd;
-    } else {
-        stringEvals += unusedId;
-    }
-    replacements[QStringLiteral("evaluateToStringCases")] = stringEvals;
-
-    QString boolEvals;
-    if (!info.boolEvaluators.isEmpty()) {
-        boolEvals += switchStart;
-        for (auto it = info.boolEvaluators.constBegin(), eit = info.boolEvaluators.constEnd();
-             it != eit; ++it) {
-            boolEvals += QStringLiteral("    case %1:\n").arg(it.key());
-            boolEvals += QStringLiteral("        return [this]()->bool{ return %1; }();\n")
-                    .arg(it.value());
-        }
-        boolEvals += switchEnd;
-    } else {
-        boolEvals += unusedId;
-    }
-    replacements[QStringLiteral("evaluateToBoolCases")] = boolEvals;
-
-    QString variantEvals;
-    if (!info.variantEvaluators.isEmpty()) {
-        variantEvals += switchStart;
-        for (auto it = info.variantEvaluators.constBegin(), eit = info.variantEvaluators.constEnd();
-             it != eit; ++it) {
-            variantEvals += QStringLiteral("    case %1:\n").arg(it.key());
-            variantEvals += QStringLiteral("        return [this]()->QVariant{ return %1; }();\n")
-                    .arg(it.value());
-        }
-        variantEvals += switchEnd;
-    } else {
-        variantEvals += unusedId;
-    }
-    replacements[QStringLiteral("evaluateToVariantCases")] = variantEvals;
-
-    QString voidEvals;
-    if (!info.voidEvaluators.isEmpty()) {
-        voidEvals = switchStart;
-        for (auto it = info.voidEvaluators.constBegin(), eit = info.voidEvaluators.constEnd();
-             it != eit; ++it) {
-            voidEvals += QStringLiteral("    case %1:\n").arg(it.key());
-            voidEvals += QStringLiteral("        [this]()->void{ %1 }();\n").arg(it.value());
-            voidEvals += QStringLiteral("        return;\n");
+    QList<QScxmlExecutableContent::EvaluatorId> ids = evaluators.keys();
+    std::sort(ids.begin(), ids.end());
+
+    const QString member = QStringLiteral("%1::qt_scxmlEvaluate<%2, %3>");
+    for (QScxmlExecutableContent::EvaluatorId id : ids) {
+        definitions += QStringLiteral("template <>\n%1 %2()\n")
+                .arg(type, member.arg(dataModel, type).arg(id));
+        if (type == QStringLiteral("void"))
+            definitions += QStringLiteral("{ %1 }\n\n").arg(evaluators.value(id));
+        else
+            definitions += QStringLiteral("{ return %1; }\n\n").arg(evaluators.value(id));
+    }
+
+    // An array without elements can't be defined. It is declared, but not used then.
+    if (ids.isEmpty()) {
+        entries += QStringLiteral("    nullptr, 0,\n");
+        return;
+    }
+
+    const QString array = QStringLiteral("qt_scxml%1Evaluators").arg(kind);
+    const QString evaluatorType = QStringLiteral("QScxmlCppDataModel::EvaluatorTable::%1Evaluator")
+            .arg(kind);
+    arrays += QStringLiteral("const %1 %2::%3[] = {\n").arg(evaluatorType, dataModel, array);
+    const int count = ids.last() + 1;
+    for (int id = 0, next = 0; id != count; ++id) {
+        if (ids.at(next) == id) {
+            arrays += QStringLiteral("    static_cast<%1>(&%2),\n")
+                    .arg(evaluatorType, member.arg(dataModel, type).arg(id));
+            ++next;
+        } else {
+            arrays += QStringLiteral("    nullptr,\n");
         }
-        voidEvals += switchEnd;
-    } else {
-        voidEvals += unusedId;
     }
-    replacements[QStringLiteral("evaluateToVoidCases")] = voidEvals;
+    arrays += QStringLiteral("};\n\n");
+    entries += QStringLiteral("    %1, %2,\n").arg(array).arg(count);
+}
+
+void generateCppDataModelEvaluators(const GeneratedTableData::DataModelInfo &info,
+                                    const QString &dataModel, Replacements &replacements)
+{
+    QString definitions;
+    QString arrays;
+    QString entries;
+    generateCppDataModelEvaluatorTable(info.stringEvaluators, dataModel, QStringLiteral("QString"),
+                                       QStringLiteral("String"), definitions, arrays, entries);
+    generateCppDataModelEvaluatorTable(info.boolEvaluators, dataModel, QStringLiteral("bool"),
+                                       QStringLiteral("Bool"), definitions, arrays, entries);
+    generateCppDataModelEvaluatorTable(info.variantEvaluators, dataModel, QStringLiteral("QVariant"),
+                                       QStringLiteral("Variant"), definitions, arrays, entries);
+    generateCppDataModelEvaluatorTable(info.voidEvaluators, dataModel, QStringLiteral("void"),
+                                       QStringLiteral("Void"), definitions, arrays, entries);
+    entries.chop(2); // trailing ",\n"
+
+    replacements[QStringLiteral("evaluators")] = definitions;
+    replacements[QStringLiteral("evaluatorArrays")] = arrays;
+    replacements[QStringLiteral("evaluatorTableEntries")] = entries;
 }
 
 int createFactoryId(QStringList &factories, const QString &className,
@@ -467,7 +463,7 @@ void CppDumper::dump(TranslationUnit *unit)
         if (doc->root->dataModel == DocumentModel::Scxml::CppDataModel) {
             Replacements r;
             r[QStringLiteral("datamodel")] = doc->root->cppDataModelClassName;
-            generateCppDataModelEvaluators(dataModelInfos.at(i), r);
+            generateCppDataModelEvaluators(dataModelInfos.at(i), doc->root->cppDataModelClassName, r);
             genTemplate(cpp, QStringLiteral(":/cppdatamodel.t"), r);
         }
     }
@@ -558,15 +554,18 @@ void CppDumper::writeImplStart()
     cpp << l("#include \"") << headerName << l("\"") << Qt::endl;
     cpp << Qt::endl
         << QStringLiteral("#include <qscxmlinvokableservice.h>") << Qt::endl
-        << QStringLiteral("#include <qscxmltabledata.h>") << Qt::endl;
-    for (const QString &inc : qAsConst(includes)) {
-        cpp << l("#include <") << inc << l(">") << Qt::endl;
-    }
-    cpp << Qt::endl
-        << revisionCheck.arg(m_translationUnit->scxmlFileName,
+        << QStringLiteral("#include <qscxmltabledata.h>") << Qt::endl
+        << Qt::endl;
+    // The check goes before the data model headers, so that a mismatch is reported before any
+    // error in the Q_SCXML_DATAMODEL declarations or the code generated for them.
+    cpp << revisionCheck.arg(m_translationUnit->scxmlFileName,
                              QString::number(Q_QSCXMLC_OUTPUT_REVISION),
                              QString::fromLatin1(QT_VERSION_STR))
         << Qt::endl;
+    for (const QString &inc : qAsConst(includes)) {
+        cpp << l("#include <") << inc << l(">") << Qt::endl;
+    }
+    cpp << Qt::endl;
     if (!m_translationUnit->namespaceName.isEmpty())
         cpp << l("namespace ") << m_translationUnit->namespaceName << l(" {") << Qt::endl << Qt::endl;
 }